@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * @brief What an AudioManager costs, for profiling (see AudioManager::GetStats).
+ *
+ * The per-tick figures (OpenAL calls, time in Update and UpdateSpatial2D,
+ * load latencies) are only collected when AUDIO_STATS is defined at compile
+ * time; otherwise the instrumentation compiles to nothing and they stay 0.
+ * Voice counts, resident PCM and the fade count are read from the manager's
+ * state when queried, so they are always there.
+ */
+struct AudioStats {
+#ifdef AUDIO_STATS
+    static const bool kEnabled = true;
+#else
+    static const bool kEnabled = false;
+#endif
+    static const int kLoadBuckets = 12;
+
+    int activeVoices = 0;      /**< Pooled sources bound to a sound or playing a one-shot. */
+    int virtualVoices = 0;     /**< Sounds playing without a source (streams excluded). */
+    int fades = 0;             /**< Gain ramps running (FadeTo and Crossfade). */
+    size_t residentBytes = 0;  /**< PCM held in buffers and stream blocks. */
+
+    uint64_t ticks = 0;
+    uint32_t alCallsLastTick = 0; /**< OpenAL calls from the start of the previous Update to the start of the last one. */
+    uint32_t alCallsMaxTick = 0;
+    uint64_t alCalls = 0;         /**< OpenAL calls made by the whole program when the last Update started. */
+    float updateMicros = 0.0f;    /**< Time of the last Update. */
+    float updateMaxMicros = 0.0f;
+    float spatialMicros = 0.0f;   /**< Time of the last UpdateSpatial2D. */
+    float spatialMaxMicros = 0.0f;
+    uint32_t loadLatency[kLoadBuckets] = {}; /**< Loads by time to upload (see LoadBucketLimit). */
+
+    static float LoadBucketLimit(int bucket);
+    void BeginTick();
+    void AddLoad(std::chrono::steady_clock::time_point requested);
+    void Dump(std::ostream& out) const;
+
+    /** @brief Counts one OpenAL call (see AL_CALL). */
+    static void CountAlCall() { alCallCounter_.fetch_add(1, std::memory_order_relaxed); }
+    static uint64_t AlCallCount() { return alCallCounter_.load(std::memory_order_relaxed); }
+
+private:
+    static std::atomic<uint64_t> alCallCounter_;
+};
+
+#ifdef AUDIO_STATS
+/** @brief Keeps a statement that only feeds AudioStats. */
+#define AUDIO_STAT(...) __VA_ARGS__
+#else
+#define AUDIO_STAT(...)
+#endif
+
+/**
+ * @brief Adds the time of a scope to a last/peak pair of AudioStats.
+ *
+ * Empty without AUDIO_STATS, so it costs nothing.
+ */
+class StatsTimer {
+public:
+#ifdef AUDIO_STATS
+    StatsTimer(float* last, float* peak) : last_(last), peak_(peak), start_(std::chrono::steady_clock::now()) {}
+    ~StatsTimer() {
+        *last_ = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start_).count();
+        if (*last_ > *peak_) *peak_ = *last_;
+    }
+
+private:
+    float* last_;
+    float* peak_;
+    std::chrono::steady_clock::time_point start_;
+#else
+    StatsTimer(float*, float*) {}
+#endif
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A tree of named mixer buses (master -> music/sfx/... -> sub-buses).
+ *
+ * Every bus has its own volume, mute and pause state; the effective gain of a
+ * bus is the product of the volumes on its path to the master, and a bus is
+ * muted or paused if any bus on that path is. Setters only record the new
+ * state; Resolve computes every effective value in one top-down pass, which
+ * is flat because a parent is always created before its children.
+ *
+ * Duck rules lower a bus while another one is active (see AddDuck): the
+ * owner marks the buses of its playing voices every tick and UpdateDucks
+ * moves each rule's attenuation towards its target.
+ */
+class BusMixer {
+public:
+    static const int kMaster = 0;
+
+    BusMixer();
+
+    int Create(const std::string& name, int parent);
+    int Find(const std::string& name) const;
+    void SetVolume(int bus, float gain);
+    void SetMuted(int bus, bool muted);
+    void SetPaused(int bus, bool paused);
+    int AddDuck(int bus, int trigger, float depthDb, float attack, float release);
+    void RemoveDuck(int duck);
+    void MarkActive(int bus);
+    void UpdateDucks(float deltaTime);
+    bool Resolve();
+    void Clear();
+
+    int Count() const { return static_cast<int>(parent_.size()); }
+    bool IsValid(int bus) const { return bus >= 0 && bus < Count(); }
+    bool HasDucks() const { return !ducks_.empty(); }
+
+    /** @brief Effective gain of the last Resolve; 0 while muted or paused. */
+    float Gain(int bus) const { return gain_[bus]; }
+    bool IsPaused(int bus) const { return (state_[bus] & kPaused) != 0; }
+
+    /** @brief Whether the last Resolve changed the effective gain or pause state of a bus. */
+    bool GainChanged(int bus) const { return (changed_[bus] & kGainChanged) != 0; }
+    bool PauseChanged(int bus) const { return (changed_[bus] & kPauseChanged) != 0; }
+
+private:
+    enum : uint8_t {
+        kMuted = 1,
+        kPaused = 2,
+        kGainChanged = 1,
+        kPauseChanged = 2,
+    };
+
+    struct Duck {
+        int bus;
+        int trigger;          /**< -1 once removed. */
+        float depth;          /**< Attenuation while triggered, in dB (negative). */
+        float attackRate;     /**< dB per second going down. */
+        float releaseRate;    /**< dB per second coming back. */
+        float level = 0.0f;   /**< Current attenuation in dB. */
+    };
+
+    std::vector<std::string> name_;
+    std::vector<int> parent_;      /**< Always a lower index; -1 for the master. */
+    std::vector<float> volume_;
+    std::vector<float> duck_;      /**< Product of the duck rules on the bus. */
+    std::vector<uint8_t> flags_;   /**< Own kMuted and kPaused, as set by the caller. */
+    std::vector<float> gain_;      /**< Effective values of the last Resolve. */
+    std::vector<uint8_t> state_;
+    std::vector<uint8_t> changed_;
+    std::vector<int> active_;      /**< Voices marked this tick, then summed up the tree. */
+    std::vector<float> nextDuck_;  /**< Scratch of UpdateDucks, kept to avoid allocating per tick. */
+    std::vector<Duck> ducks_;
+    bool dirty_;                   /**< A setter ran since the last Resolve. */
+};
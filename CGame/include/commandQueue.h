@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Bounded lock-free ring for one producer thread and one consumer thread.
+ *
+ * Push is only ever called by the producer and Pop by the consumer; neither
+ * blocks or allocates. The two indices live on separate cache lines so the
+ * threads do not invalidate each other's line on every operation.
+ */
+template <typename T>
+class SpscQueue {
+public:
+    /** @param capacity Number of slots, rounded up to a power of two. */
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size *= 2;
+        items_.resize(size);
+        mask_ = size - 1;
+    }
+
+    /** @return False if the queue is full; the value is not enqueued. */
+    bool Push(const T& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) > mask_) return false;
+        items_[head & mask_] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** @return False if the queue is empty. */
+    bool Pop(T* value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) return false;
+        *value = items_[tail & mask_];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> items_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> head_{ 0 }; /**< Next slot to write; owned by the producer. */
+    alignas(64) std::atomic<size_t> tail_{ 0 }; /**< Next slot to read; owned by the consumer. */
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <spatialKernel.h>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Uniform-grid index of circles, to find the ones that may contain a point.
+ *
+ * Each circle (an emitter and its hearing range) is filed in the bucket of
+ * its centre; buckets are square and kept in a hash map, so the world has no
+ * bounds and empty space costs nothing. A query visits only the buckets
+ * within the largest radius of the point and copies the circles found there
+ * into arrays for SpatialKernel, whose gain tells which ones do contain it.
+ * Moving a circle within its bucket only updates its position.
+ */
+class EmitterGrid {
+public:
+    EmitterGrid();
+
+    void SetBucketSize(float size);
+    void Insert(int id, float x, float y, float radius);
+    void Move(int id, float x, float y);
+    void Remove(int id);
+    void Clear();
+    void Gather(float x, float y, EmitterArrays* found) const;
+
+    /** @brief Largest radius of the circles filed now; bounds every query. */
+    float MaxRadius() const { return radii_.empty() ? 0.0f : radii_.rbegin()->first; }
+
+private:
+    struct Entry {
+        int id;
+        float x, y;
+        float radius;
+    };
+
+    struct Location {
+        int64_t key = 0;
+        int position = -1; /**< Index in the bucket, or -1 if the id is not filed. */
+    };
+
+    int64_t KeyOf(float x, float y) const;
+    void Link(const Entry& entry);
+    void Unlink(int id);
+
+    std::unordered_map<int64_t, std::vector<Entry>> buckets_; /**< Emptied buckets are kept for reuse. */
+    std::vector<Location> location_; /**< Bucket of each id. */
+    std::map<float, int> radii_;     /**< Number of filed circles of each radius, so the largest one is known after removals. */
+    float bucketSize_;
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Any number of concurrent gain ramps, advanced together once per tick.
+ *
+ * Each ramp drives the gain of one target (a small non-negative id chosen by
+ * the owner, e.g. a channel slot) from one value to another along a curve.
+ * Starting a ramp on a target that already has one replaces it, starting from
+ * whatever value the caller passes, so a ramp never gets stuck half-way.
+ *
+ * Ramps are stored as one array per field, and Advance evaluates every curve
+ * for every ramp without branching, so the whole set goes through in a single
+ * pass the compiler can vectorize.
+ */
+class FadeManager {
+public:
+    enum Curve : uint8_t {
+        kLinear,      /**< Straight line between the two gains. */
+        kEqualPower,  /**< Quarter sine; two opposite ramps keep a constant total power. */
+        kExponential, /**< Straight line in decibels, with silence treated as -60 dB. */
+    };
+
+    /** @brief What the owner should do with the target once its ramp ends. */
+    enum Action : uint8_t {
+        kNone,
+        kStop,
+        kPause,
+        kReleaseVoice,
+    };
+
+    struct Completion {
+        int target;
+        float gain; /**< The exact end gain of the ramp. */
+        Action action;
+    };
+
+    void Start(int target, float from, float to, float duration, Curve curve, Action action);
+    bool Cancel(int target);
+    bool IsFading(int target) const;
+    void Advance(float deltaTime);
+    void Clear();
+
+    int Size() const { return static_cast<int>(target_.size()); }
+    int Target(int ramp) const { return target_[ramp]; }
+    float Gain(int ramp) const { return gain_[ramp]; }
+
+    /** @brief The ramps that ended during the last Advance; they are no longer in the set. */
+    const std::vector<Completion>& Completed() const { return completed_; }
+
+private:
+    int Find(int target) const;
+    void RemoveAt(int ramp);
+
+    // Read by Advance for every ramp
+    std::vector<float> elapsed_;
+    std::vector<float> rate_;     /**< 1 / duration. */
+    std::vector<float> from_;
+    std::vector<float> delta_;    /**< to - from. */
+    std::vector<float> logFrom_;  /**< log2 of the start gain, for kExponential. */
+    std::vector<float> logDelta_;
+    std::vector<float> rising_;   /**< 1 if the gain goes up, 0 if it goes down. */
+    std::vector<float> linear_;   /**< Curve weights: exactly one of the three is 1. */
+    std::vector<float> power_;
+    std::vector<float> exponential_;
+    std::vector<float> gain_;     /**< Output of the last Advance. */
+
+    // Only touched when a ramp starts or ends
+    std::vector<float> to_;
+    std::vector<int> target_;
+    std::vector<Action> action_;
+    std::vector<int> rampOf_;     /**< Ramp index of each target id, or -1. */
+    std::vector<Completion> completed_;
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <../deps/OpenAL/include/AL/al.h>
+#include <../deps/OpenAL/include/AL/alc.h>
+#include <../deps/OpenAL/include/AL/efx.h>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Wall occlusion between the listener and 2D emitters, traced on a collision grid.
+ *
+ * The grid is a copy of the game's collision cells (nonzero = wall). A trace
+ * walks the cells on the line between two cells and counts the walls it
+ * crosses; each wall lowers the sound a little and muffles it a lot, the
+ * muffling being an EFX low-pass filter on the source's direct path.
+ *
+ * One filter object serves every source: OpenAL copies a filter's settings
+ * into a source when it is attached, so the filter is only a template.
+ * Without ALC_EXT_EFX the walls still lower the gain but nothing is muffled.
+ */
+class Occlusion {
+public:
+    Occlusion();
+
+    bool Init(ALCdevice* device);
+    void Close();
+
+    void SetGrid(const int* cells, int width, int height, float cellSize);
+    bool HasGrid() const { return !walls_.empty(); }
+    int CellOf(float position) const;
+    int Trace(int x0, int y0, int x1, int y1) const;
+    void ApplyLowpass(ALuint source, float gainHF) const;
+
+    static float Gain(int walls);
+    static float GainHF(int walls);
+
+    bool IsAvailable() const { return filter_ != 0; }
+
+private:
+    bool IsWall(int x, int y) const;
+
+    LPALGENFILTERS genFilters_;
+    LPALDELETEFILTERS deleteFilters_;
+    LPALFILTERI filteri_;
+    LPALFILTERF filterf_;
+    ALuint filter_; /**< Low-pass template, 0 while EFX is unavailable. */
+
+    std::vector<uint8_t> walls_; /**< 1 per wall cell, row-major. */
+    int width_, height_;
+    float cellSize_;
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <spatialKernel.h>
+#include <wavFile.h>
+#include <cstddef>
+
+/**
+ * @brief Turns WAV samples OpenAL cannot take as they are into a format it can.
+ *
+ * 8 and 16-bit PCM always go up as they are, and floats too when the device
+ * has AL_EXT_FLOAT32; 24 and 32-bit integers are then widened to floats, so
+ * nothing is lost. Without the extension everything else is reduced to
+ * 16-bit. The conversions run at the level picked by SpatialKernel::Detect
+ * and give the same samples bit for bit at every level.
+ */
+class SampleConvert {
+public:
+    static ALenum TargetFormat(const WavInfo& info, bool floatFormats);
+    static int SampleBytes(WavEncoding encoding);
+    static size_t TargetSize(WavEncoding encoding, size_t bytes, ALenum format);
+    static void Convert(WavEncoding encoding, const unsigned char* samples, size_t bytes, ALenum format, void* out);
+    static void Convert(WavEncoding encoding, const unsigned char* samples, size_t bytes, ALenum format, void* out,
+        SpatialKernel::Level level);
+};
@@ -0,0 +1,123 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Generation-checked reference to an element of a SlotMap.
+ *
+ * The tag only makes handles of different kinds distinct types, so a sound
+ * handle cannot be passed where an emitter handle is expected. A default
+ * constructed handle is null and never resolves.
+ */
+template <typename Tag>
+struct Handle {
+    uint32_t index = 0;
+    uint32_t generation = 0; /**< 0 is never used by a live slot. */
+
+    bool IsNull() const { return generation == 0; }
+    bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const Handle& other) const { return !(*this == other); }
+};
+
+struct SoundTag;
+struct VoiceTag;
+struct EmitterTag;
+
+using SoundHandle = Handle<SoundTag>;     /**< A loaded or streamed sound (see AudioManager::LoadWav). */
+using VoiceHandle = Handle<VoiceTag>;     /**< One playback on a pooled voice (see AudioManager::PlayOneShot). */
+using EmitterHandle = Handle<EmitterTag>; /**< A registered 2D sound position (see AudioManager::Register2DSound). */
+
+/**
+ * @brief Vector of values addressed through generation-checked handles.
+ *
+ * Lookups are O(1). Removing a value bumps its slot's generation, so every
+ * handle to it goes stale and resolves to nothing, even after the slot is
+ * reused by a later Insert. Slots never move, so the owner may also keep
+ * plain slot indices internally and walk the slots directly.
+ */
+template <typename T, typename H>
+class SlotMap {
+public:
+    H Insert(T value) {
+        uint32_t index;
+        if (!free_.empty()) {
+            index = free_.back();
+            free_.pop_back();
+        }
+        else {
+            index = static_cast<uint32_t>(slots_.size());
+            slots_.emplace_back();
+        }
+
+        Slot& slot = slots_[index];
+        slot.value = std::move(value);
+        slot.live = true;
+        size_++;
+
+        H handle;
+        handle.index = index;
+        handle.generation = slot.generation;
+        return handle;
+    }
+
+    bool Remove(H handle) {
+        int index = Find(handle);
+        if (index < 0) return false;
+        RemoveAt(index);
+        return true;
+    }
+
+    void RemoveAt(int index) {
+        Slot& slot = slots_[index];
+        slot.value = T();
+        slot.live = false;
+        if (++slot.generation == 0) slot.generation = 1; // Skip the null generation on wrap-around
+        free_.push_back(static_cast<uint32_t>(index));
+        size_--;
+    }
+
+    /** @brief Returns the slot index of a live handle, or -1 if it is null or stale. */
+    int Find(H handle) const {
+        if (handle.index >= slots_.size()) return -1;
+        const Slot& slot = slots_[handle.index];
+        if (!slot.live || slot.generation != handle.generation) return -1;
+        return static_cast<int>(handle.index);
+    }
+
+    T* Get(H handle) {
+        int index = Find(handle);
+        return index < 0 ? nullptr : &slots_[index].value;
+    }
+
+    H HandleAt(int index) const {
+        H handle;
+        handle.index = static_cast<uint32_t>(index);
+        handle.generation = slots_[index].generation;
+        return handle;
+    }
+
+    void Clear() {
+        for (int i = 0; i < SlotCount(); i++) {
+            if (slots_[i].live) RemoveAt(i);
+        }
+    }
+
+    int SlotCount() const { return static_cast<int>(slots_.size()); }
+    bool IsLive(int index) const { return slots_[index].live; }
+    size_t Size() const { return size_; }
+
+    T& operator[](int index) { return slots_[index].value; }
+    const T& operator[](int index) const { return slots_[index].value; }
+
+private:
+    struct Slot {
+        T value = T();
+        uint32_t generation = 1;
+        bool live = false;
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> free_; /**< Dead slots, reused last-in first-out. */
+    size_t size_ = 0;
+};
@@ -1,48 +1,429 @@
 #pragma once
 #include <../deps/OpenAL/include/AL/al.h>
 #include <../deps/OpenAL/include/AL/alc.h>
+#include <../deps/OpenAL/include/AL/alext.h>
+#include <wavFile.h>
+#include <audioStream.h>
+#include <soundBank.h>
+#include <slotMap.h>
+#include <commandQueue.h>
+#include <fadeManager.h>
+#include <busMixer.h>
+#include <reverbZones.h>
+#include <occlusion.h>
+#include <pathField.h>
+#include <emitterGrid.h>
+#include <spatialKernel.h>
+#include <audioStats.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+// AL_SOFT_events is newer than the bundled alext.h; the values are those of OpenAL Soft
+#ifndef AL_SOFT_events
+#define AL_SOFT_events 1
+#define AL_EVENT_CALLBACK_FUNCTION_SOFT          0x19A2
+#define AL_EVENT_CALLBACK_USER_PARAM_SOFT        0x19A3
+#define AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT      0x19A4
+#define AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT  0x19A5
+#define AL_EVENT_TYPE_DISCONNECTED_SOFT          0x19A6
+typedef void (AL_APIENTRY* ALEVENTPROCSOFT)(ALenum eventType, ALuint object, ALuint param,
+    ALsizei length, const ALchar* message, void* userParam);
+typedef void (AL_APIENTRY* LPALEVENTCONTROLSOFT)(ALsizei count, const ALenum* types, ALboolean enable);
+typedef void (AL_APIENTRY* LPALEVENTCALLBACKSOFT)(ALEVENTPROCSOFT callback, void* userParam);
+#endif
+
+#ifndef AL_SOFT_source_start_delay
+#define AL_SOFT_source_start_delay 1
+typedef void (AL_APIENTRY* LPALSOURCEPLAYATTIMESOFT)(ALuint source, ALint64SOFT startTime);
+#endif
+
 class AudioManager {
 public:
     AudioManager();
     ~AudioManager();
 
-    bool Init();
-    int LoadWav(const std::string& filename);
+    static const int kDefaultVoices = 32;
+    static constexpr float kOneShotDistance = 10.0f;
+    static const int kDefaultTickRate = 200;
+    static const int kLoopbackRate = 48000;
+
+    /** @brief How distance is measured for 2D sounds (see SetPropagation). */
+    enum Propagation {
+        kStraightLine, /**< Distance through the air; walls in between lower the sound (see SetCollisionGrid). */
+        kPathDistance, /**< Walking distance around the walls of the collision grid. */
+    };
+
+    /** @brief How 2D sounds are rendered (see SetListenerMode). */
+    enum ListenerMode {
+        kPanned2D, /**< Gain and left/right panning computed here, facing up the screen. */
+        kWorld3D,  /**< Sources and listener placed in the world; OpenAL attenuates and pans. */
+    };
+
+    /** @brief Where a sound is in its loading (see GetLoadStatus). */
+    enum LoadStatus {
+        kLoading,    /**< Waiting for a background load (see LoadWavAsync). */
+        kLoaded,     /**< Has its buffer, or its stream. */
+        kLoadFailed, /**< The file could not be loaded, or the handle is stale: a failed load unloads its sound. */
+    };
+
+    /** @brief Reported when a playback reaches its end (see SetEndCallback). */
+    struct PlaybackEnded {
+        SoundHandle sound;
+        VoiceHandle voice; /**< The one-shot that ended, or null if the sound's own playback ended. */
+    };
+
+    bool Init(int maxVoices = kDefaultVoices);
+    bool InitLoopback(int sampleRate = kLoopbackRate, int maxVoices = kDefaultVoices);
+    int Render(float deltaTime);
+    const float* RenderedSamples() const;
+    bool StartCapture(const std::string& filename);
+    bool StopCapture();
+    void StartAudioThread(int tickRate = kDefaultTickRate);
+    void StopAudioThread();
+    SoundHandle LoadWav(const std::string& filename);
+    SoundHandle LoadWavAsync(const std::string& filename);
+    bool IsLoaded(SoundHandle sound);
+    LoadStatus GetLoadStatus(SoundHandle sound);
+    bool WaitLoaded(SoundHandle sound);
+    void WaitForLoads();
+    void Unload(SoundHandle sound);
+    bool LoadBank(const std::string& filename);
+    SoundHandle GetSound(const std::string& name);
+    SoundHandle OpenStream(const std::string& filename);
+    void PlayStream(SoundHandle sound, bool loop = true);
 
-    void Play(int index, bool loop = false);
-    void Stop(int index);
+    void Play(SoundHandle sound, bool loop = false, int priority = 0);
+    void PlayAt(SoundHandle sound, int64_t clockTimeNs, bool loop = false, int priority = 0);
+    void QueueAfter(SoundHandle current, SoundHandle next, bool loop = false);
+    int64_t ClockTime();
+    int LastSeamError();
+    void Stop(SoundHandle sound);
     void Close();
-    void SetVolume(int index, float gain);
+    void SetVolume(SoundHandle sound, float gain);
+    void FadeTo(SoundHandle sound, float gain, float duration, FadeManager::Curve curve = FadeManager::kLinear,
+        FadeManager::Action action = FadeManager::kNone);
+    void Pause(SoundHandle sound);
+    void Resume(SoundHandle sound);
+
+    int CreateBus(const std::string& name, int parent = BusMixer::kMaster);
+    int GetBus(const std::string& name);
+    void SetBus(SoundHandle sound, int bus);
+    void SetBusVolume(int bus, float gain);
+    void SetBusMuted(int bus, bool muted);
+    void SetBusPaused(int bus, bool paused);
+    int AddDuckRule(int bus, int trigger, float depthDb, float attack, float release);
+    void RemoveDuckRule(int rule);
+
+    void SetReverbGrid(int width, int height, float cellSize = 1.0f);
+    int AddReverbZone(const EFXEAXREVERBPROPERTIES& preset);
+    void SetReverbZoneRect(int zone, int x, int y, int width, int height);
+    void SetReverbZoneMask(int zone, const unsigned char* mask);
+    int GetReverbZone();
+    void SetCollisionGrid(const int* cells, int width, int height, float cellSize = 1.0f);
+    void SetPropagation(Propagation mode);
+    void SetListenerMode(ListenerMode mode);
+    bool SetHrtf(bool enabled);
+
+    bool IsPlaying(SoundHandle sound);
+
+    VoiceHandle PlayOneShot(SoundHandle sound, float x, float y, float pitchRange = 0.0f, float gainRange = 0.0f,
+        float maxDistance = kOneShotDistance, int priority = 0);
+    bool IsVoicePlaying(VoiceHandle voice);
+    void StopVoice(VoiceHandle voice);
 
     void Update(float deltaTime);
-    void Crossfade(int fromIndex, int toIndex, float duration);
+    void SetEndCallback(std::function<void(const PlaybackEnded&)> callback);
+    void Crossfade(SoundHandle from, SoundHandle to, float duration, FadeManager::Curve curve = FadeManager::kLinear);
 
     void UpdateSpatial2D(float listenerX, float listenerY);
-    void SetSourcePosition(int index, float x, float y);
-    void Register2DSound(int index, float x, float y, float maxDistance);
+    void SetListenerFacing(float facingX, float facingY);
+    void SetSourcePosition(EmitterHandle emitter, float x, float y);
+    EmitterHandle Register2DSound(SoundHandle sound, float x, float y, float maxDistance);
+    void SetEmitterRolloff(EmitterHandle emitter, float rolloff);
+    void Unregister2DSound(EmitterHandle emitter);
+
+    AudioStats GetStats();
 
 private:
-    struct Fade {
-        int from = -1;
-        int to = -1;
+    struct CachedBuffer {
+        ALuint buffer = 0;  /**< 0 while an asynchronous load is in flight. */
+        int refCount = 0;   /**< Number of channels created from this buffer. */
         float duration = 0.0f;
-        float elapsed = 0.0f;
-        bool active = false;
+        ALenum format = AL_NONE; /**< Buffers can only share a source queue if format and rate match. */
+        int sampleRate = 0;
+        size_t bytes = 0;   /**< Size of the PCM, for AudioStats::residentBytes. */
+        std::chrono::steady_clock::time_point requested; /**< When LoadWavAsync queued the file (AUDIO_STATS only). */
+        MappedFile mapping; /**< Backing file of a static (zero-copy) buffer, otherwise closed. */
+    };
+
+    struct LoadResult {
+        std::string key;
+        MappedFile file;
+        WavInfo info;
+        ALenum format = AL_NONE;               /**< Upload format; info.format unless the samples were converted. */
+        std::vector<unsigned char> converted;  /**< The samples after SampleConvert, when they needed it. */
+        bool ok = false;
+        std::chrono::steady_clock::time_point requested; /**< When LoadWav or GetSound was called (AUDIO_STATS only). */
+    };
+
+    /** @brief A stream opened by OpenStream, waiting for the tick to create its source. */
+    struct PendingStream {
+        SoundHandle sound;
+        std::unique_ptr<AudioStream> stream;
+    };
+
+    /**
+     * @brief A logical sound instance. Owns no OpenAL source; it borrows a
+     * voice from the pool only while it is audible and wins the priority race.
+     */
+    struct Channel {
+        bool loading = false;  /**< Waiting for a background load (see LoadWavAsync). */
+        bool playing = false;  /**< Logically playing, whether on a voice or virtual. */
+        bool paused = false;   /**< Stopped by Pause, keeping its position for Resume. */
+        bool loop = false;
+        int priority = 0;
+        int bus = BusMixer::kMaster;
+        int voice = -1;        /**< Index into voices_, or -1 while virtual or stopped. */
+        int stream = -1;       /**< Index into streams_, or -1 for fully loaded sounds. */
+        int next = -1;         /**< Channel that starts when this one ends (see QueueAfter), or -1. */
+        int follows = -1;      /**< Channel this one is queued after, or -1. Voiceless while linked, unless scheduled on its own voice. */
+        bool nextQueued = false; /**< The buffer of next is queued behind ours on our voice. */
+        std::string staleKey; /**< Buffer of a cancelled follower still queued behind ours, held until the voice is cut on reaching it; empty if none. */
+        int64_t startAt = -1;  /**< Audio clock time (ns) of a pending PlayAt, or -1. */
+        int64_t endsAt = -1;   /**< Predicted end on the audio clock while a follower waits, or -1. */
+        ALuint buffer = 0;
+        float duration = 0.0f; /**< Length of the buffer in seconds. */
+        float position = 0.0f; /**< Playback position in seconds, tracked while virtual. */
+        float gain = 1.0f;     /**< Own gain, before the bus gain (see HeardGain). */
+        float panning = 0.0f;
+        bool placed = false;   /**< Positioned in the world (kWorld3D) rather than panned. */
+        float x = 0.0f, y = 0.0f;  /**< World position while placed. */
+        float maxDistance = 0.0f, rolloff = 1.0f;
+        float lowpass = 1.0f;  /**< High-frequency gain of the wall occlusion (see Occlusion). */
+        std::string soundKey;  /**< bufferCache_ key, empty for streams. */
+    };
+
+    /**
+     * @brief An OpenAL source plus a shadow copy of the properties last
+     * submitted to it, so unchanged values never reach the driver.
+     */
+    struct ShadowSource {
+        ALuint id = 0;
+        float gain = -1.0f;  /**< Negative until first submitted. */
+        float pitch = -1.0f; /**< Negative until first submitted. */
+        float x = 0.0f, y = 0.0f, z = 0.0f;
+        bool positioned = false;
+        int relative = -1;   /**< -1 until first submitted. */
+        float maxDistance = -1.0f; /**< Negative until first submitted. */
+        float rolloff = -1.0f;
+        int looping = -1;    /**< -1 until first submitted. */
+        float lowpass = 1.0f; /**< 1 while no filter is attached. */
+
+        void SetGain(float value);
+        void SetPitch(float value);
+        void SetPanning(float value);
+        void SetWorldPosition(float worldX, float worldY, float range, float rolloffFactor);
+        void SetLooping(bool value);
+        void SetPosition(float px, float py, float pz, bool isRelative);
+    };
+
+    /** @brief A pooled OpenAL source. */
+    struct Voice {
+        ShadowSource source;
+        int channel = -1;        /**< Channel currently bound, or -1. */
+        int oneShotOf = -1;      /**< Channel whose buffer a one-shot is playing, or -1. */
+        int priority = 0;        /**< One-shots only; bound channels use their own. */
+        float gain = 0.0f;       /**< One-shots only, before the bus gain; bound channels use their own. */
+        uint32_t generation = 1; /**< Bumped every time the voice is freed (see VoiceHandle). */
+    };
+
+    struct StreamSlot {
+        int channel;
+        ShadowSource source; /**< Streams keep a dedicated source and are never virtualized. */
+        std::shared_ptr<AudioStream> stream; /**< Shared with the reader thread while it fills the stream. */
+        bool playing = false; /**< Started and not stopped; cleared when the end is reported. */
+    };
+
+    /** @brief A deferred call to one of the real-time methods (see Post). */
+    struct Command {
+        enum Type {
+            kPlay, kStop, kSetVolume, kCrossfade, kPlayStream, kSetPosition, kSetListener, kPlayOneShot, kStopVoice,
+            kPlayAt, kQueueAfter, kFadeTo, kPause, kResume, kSetBus, kSetBusVolume, kSetBusMuted, kSetBusPaused,
+            kSetFacing
+        };
+        Type type = kPlay;
+        SoundHandle sound;
+        SoundHandle target;     /**< Crossfade destination, or the sound queued by QueueAfter. */
+        EmitterHandle emitter;
+        VoiceHandle voice;
+        float x = 0.0f, y = 0.0f;
+        float value = 0.0f;     /**< Gain. */
+        float duration = 0.0f;  /**< Fade length. */
+        float pitchRange = 0.0f, gainRange = 0.0f, maxDistance = 0.0f;
+        int64_t time = 0;       /**< PlayAt start time. */
+        FadeManager::Curve curve = FadeManager::kLinear;
+        FadeManager::Action action = FadeManager::kNone;
+        int priority = 0;
+        int bus = 0;
+        bool loop = false;
+        bool enabled = false;   /**< Mute or pause state. */
     };
 
     struct SoundSource2D {
-        int sourceIndex;
-        float x, y;
-        float maxDistance;
+        int channel = -1; /**< Slot of the sound in channels_. */
+        float x = 0.0f, y = 0.0f;
+        float maxDistance = 0.0f;
+        bool traced = false;   /**< walls is valid for cellX/cellY and the listener's cell. */
+        int cellX = 0, cellY = 0;
+        int walls = 0;         /**< Walls between the emitter and the listener at the last trace. */
+        uint32_t seen = 0;     /**< Last UpdateSpatial2D that found the listener in range. */
+        float rolloff = 1.0f;  /**< How fast the sound fades with distance in kWorld3D. */
     };
 
     ALCdevice* device_;
     ALCcontext* context_;
-    std::vector<ALuint> sources_;
-    std::vector<ALuint> buffers_;
-    std::vector<SoundSource2D> spatialSources_;
-    Fade fade_;
+    SlotMap<Channel, SoundHandle> channels_; /**< Internally addressed by slot index. */
+    std::vector<Voice> voices_;   /**< Fixed pool created by Init. */
+    std::vector<int> candidates_; /**< Scratch list of virtual channels waiting for a voice. */
+    std::unordered_map<std::string, CachedBuffer> bufferCache_;
+    std::vector<std::unique_ptr<SoundBank>> banks_; /**< Must outlive the buffers created from them. */
+    PFNALBUFFERDATASTATICPROC bufferDataStatic_; /**< alBufferDataStatic, or null if AL_EXT_STATIC_BUFFER is missing. */
+    bool floatFormats_; /**< AL_EXT_FLOAT32 is there: float WAVs load as they are (see SampleConvert). */
+    LPALDEFERUPDATESSOFT deferUpdates_;     /**< alDeferUpdatesSOFT, or null if AL_SOFT_deferred_updates is missing. */
+    LPALPROCESSUPDATESSOFT processUpdates_;
+    int batchDepth_; /**< Nesting of BeginBatch/EndBatch. */
+    LPALEVENTCONTROLSOFT eventControl_;   /**< alEventControlSOFT, or null if AL_SOFT_events is missing. */
+    LPALEVENTCALLBACKSOFT eventCallback_;
+    std::unordered_map<ALuint, int> sourceVoices_; /**< Voice index of each pooled source, for source events. */
+    LPALCGETINTEGER64VSOFT getInteger64_;  /**< alcGetInteger64vSOFT, or null if ALC_SOFT_device_clock is missing. */
+    LPALSOURCEPLAYATTIMESOFT playAtTime_;  /**< alSourcePlayAtTimeSOFT; only set along with getInteger64_. */
+    LPALGETSOURCEI64VSOFT getSourcei64_;   /**< alGetSourcei64vSOFT (AL_SOFT_source_latency); only set along with playAtTime_. */
+    int lastSeamError_; /**< Samples between the end of a sound and the start of its follower (see LastSeamError). */
+    std::vector<StreamSlot> streams_;
+    std::vector<PendingStream> pendingStreams_; /**< Opened streams waiting for their source (see AttachStreams). */
+    SlotMap<SoundSource2D, EmitterHandle> spatialSources_;
+    EmitterGrid emitterGrid_;     /**< Range circles of spatialSources_, by slot. */
+    std::vector<int> inRange_;    /**< Emitters heard at the last UpdateSpatial2D, plus the ones registered since. */
+    EmitterArrays nearby_;        /**< Emitters gathered around the listener, attenuated together. */
+    std::vector<int> heard_;      /**< Scratch list of the gathered emitters in range. */
+    uint32_t spatialTick_;        /**< Number of UpdateSpatial2D calls, for SoundSource2D::seen. */
+    FadeManager fades_; /**< Gain ramps of FadeTo and Crossfade, keyed by channel slot. */
+    BusMixer buses_;
+    ReverbZones reverb_; /**< Follows listenerX_/listenerY_. */
+    Occlusion occlusion_;
+    PathField paths_;   /**< Filled from the listener while propagation_ is kPathDistance. */
+    Propagation propagation_;
+    float listenerX_, listenerY_; /**< Last listener position given to UpdateSpatial2D. */
+    int listenerCellX_, listenerCellY_; /**< Collision cell of the listener at the last trace. */
+    ListenerMode listenerMode_;
+    float facingX_, facingY_;     /**< Direction the listener faces in kWorld3D. */
+    bool listenerDirty_;          /**< The OpenAL listener must be placed again. */
+    LPALCRESETDEVICESOFT resetDevice_; /**< alcResetDeviceSOFT, or null if ALC_SOFT_HRTF is missing. */
+    LPALCRENDERSAMPLESSOFT renderSamples_; /**< alcRenderSamplesSOFT; only set by InitLoopback. */
+    ALCenum renderType_;          /**< ALC_FLOAT_SOFT or ALC_SHORT_SOFT. */
+    int renderRate_;
+    double renderPending_;        /**< Fraction of a frame Render still owes. */
+    int64_t renderedFrames_;
+    std::vector<float> renderOutput_;   /**< Stereo frames of the last Render, interleaved. */
+    std::vector<int16_t> renderShorts_; /**< Scratch for 16-bit rendering and capture. */
+    WavWriter capture_;
+    std::vector<int> traceQueue_; /**< Scratch list of the emitters TraceOcclusion retraces. */
+    std::mt19937 random_;         /**< Pitch and gain variation of one-shots. */
+    AudioStats stats_;            /**< Tick counters; the rest is filled in by GetStats. */
+
+    bool InitContext(const ALCint* formatAttributes, int maxVoices);
+    int CreateChannel(const std::string& key);
+    SoundHandle CreateSource(const CachedBuffer& entry, const std::string& key);
+    void UnloadChannel(int index);
+    void PlayChannel(int index, bool loop, int priority);
+    void ReadWav(LoadResult& result) const;
+    SoundHandle ShareBuffer(const std::string& key);
+    SoundHandle PublishLoad(LoadResult&& result);
+    void ReleaseBuffer(const std::string& key);
+    int SlotOf(SoundHandle sound) const;
+    void UploadBuffer(CachedBuffer& entry, const unsigned char* samples, size_t size, ALenum format, int sampleRate,
+        bool mapped);
+    ShadowSource* SourceOf(const Channel& channel);
+    void BeginBatch();
+    void EndBatch();
+    void SetChannelGain(int index, float gain);
+    float HeardGain(const Channel& channel) const;
+    void ApplyBuses();
+    void ApplyDucking(float deltaTime);
+    bool IsStronger(const Channel& a, const Channel& b) const;
+    int AcquireVoice(int priority, float gain);
+    bool AssignVoice(int index);
+    void BindVoice(int index, int voice, int64_t startTime = -1);
+    void ReleaseVoice(int index, bool keepPosition);
+    void FreeVoice(int voice);
+    int VoiceOf(VoiceHandle voice) const;
+    void UpdateVoices(float deltaTime);
+    void EndIfStopped(int voice);
+    void UpdateFollower(int voice, int64_t now);
+    void StartFollower(int index, float offset);
+    void PassSeam(int index);
+    bool Unlink(int index);
+    void StartScheduled(int index, int64_t now);
+    const CachedBuffer* BufferOf(const Channel& channel) const;
+    void ReportEnded(int index, VoiceHandle voice);
+    void DispatchEvents();
+    static void AL_APIENTRY OnSourceEvent(ALenum type, ALuint object, ALuint param, ALsizei length,
+        const ALchar* message, void* userParam);
+    void ProcessLoads();
+    void AttachStreams();
+    void WaitForLoadResult();
+    void LoadWorkerLoop();
+    void StartSource(int index);
+    void StartStream(StreamSlot& slot, bool loop);
+    void StopSource(int index);
+    void PauseChannel(int index);
+    void ResumeChannel(int index);
+    void ApplyFades(float deltaTime);
+    void TraceOcclusion(float listenerX, float listenerY);
+    void LeaveRange(int emitter);
+    void RemoveEmitter(int emitter);
+    float PropagatedGain(float x, float y, float maxDistance, float distanceGain, int walls) const;
+    void PlaceSource(ShadowSource& source, const Channel& channel);
+    void PlaceListener();
+    void SetSourceLowpass(ShadowSource& source, float gainHF);
+    void StreamReaderLoop();
+    bool Post(const Command& command);
+    void Execute(const Command& command);
+    void AudioThreadLoop(int tickRate);
+
+    std::thread streamReader_;
+    std::mutex streamMutex_; /**< Guards streams_ against the reader thread, which copies the list under it. */
+    std::condition_variable streamWake_;
+    bool streamReaderQuit_;
+
+    SpscQueue<Command> commands_; /**< Game thread to audio thread. */
+    std::thread audioThread_;
+    std::atomic<bool> audioThreaded_; /**< The audio thread is running; real-time calls are posted. */
+    std::atomic<bool> audioThreadQuit_;
+    std::mutex stateMutex_; /**< Held by the audio thread while it ticks, and by the non-real-time methods. */
+
+    SpscQueue<ALuint> stoppedSources_;      /**< OpenAL event thread to the ticking thread. */
+    std::atomic<bool> stoppedOverflow_;     /**< A stop event was dropped; the next tick polls every voice. */
+    SpscQueue<PlaybackEnded> endedEvents_;  /**< Ticking thread to the thread calling Update; pushed under stateMutex_ only. */
+    std::function<void(const PlaybackEnded&)> endCallback_;
+    bool reportEnds_; /**< An end callback is set; read by the tick under stateMutex_. */
+
+    std::vector<std::thread> loadWorkers_;
+    std::deque<std::string> loadQueue_;     /**< Cache keys waiting for a worker. */
+    std::vector<LoadResult> loadResults_;   /**< Parsed files waiting for their upload. */
+    std::mutex loadMutex_; /**< Guards loadQueue_, loadResults_ and loadQuit_. */
+    std::condition_variable loadWake_;
+    std::condition_variable loadDone_;
+    std::condition_variable loadsAttached_; /**< Signalled under stateMutex_ when ProcessLoads attached something. */
+    bool loadQuit_;
 };
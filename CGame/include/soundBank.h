@@ -0,0 +1,73 @@
+#pragma once
+#include <../deps/OpenAL/include/AL/al.h>
+#include <wavFile.h>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief On-disk layout of a packed sound bank (see mainBankBuilder.cpp).
+ *
+ * [BankHeader][slots: uint32 * slotCount][entries: BankEntry * entryCount][names][PCM blobs]
+ *
+ * The slots form an open-addressing hash table (linear probing) holding
+ * entry index + 1, or 0 for an empty slot. Every PCM blob starts on a
+ * kBankAlignment boundary and is already in a format OpenAL accepts.
+ */
+static const char kBankMagic[4] = { 'S', 'B', 'N', 'K' };
+static const uint32_t kBankVersion = 1;
+static const uint64_t kBankAlignment = 64;
+
+struct BankHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t slotCount;     /**< Power of two, larger than entryCount. */
+    uint64_t slotsOffset;
+    uint64_t entriesOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+};
+
+struct BankEntry {
+    uint64_t nameHash;
+    uint64_t dataOffset;
+    uint64_t dataSize;
+    uint32_t nameOffset;    /**< Relative to BankHeader::namesOffset. */
+    uint32_t nameLength;
+    int32_t format;         /**< OpenAL buffer format. */
+    int32_t sampleRate;
+};
+
+static_assert(sizeof(BankHeader) == 48, "BankHeader layout is part of the file format");
+static_assert(sizeof(BankEntry) == 40, "BankEntry layout is part of the file format");
+
+/**
+ * @brief A sound stored in a bank, pointing into the bank's mapping.
+ */
+struct BankSound {
+    const unsigned char* samples = nullptr;
+    size_t dataSize = 0;
+    ALenum format = 0;
+    int sampleRate = 0;
+};
+
+/**
+ * @brief Read-only view of a packed sound bank opened with a single mapping.
+ */
+class SoundBank {
+public:
+    SoundBank();
+
+    bool Open(const std::string& filename);
+    bool Find(const std::string& name, BankSound* sound) const;
+    uint32_t Count() const { return header_.entryCount; }
+
+    static uint64_t HashName(const std::string& name);
+
+private:
+    MappedFile file_;
+    BankHeader header_;
+    const uint32_t* slots_;
+    const BankEntry* entries_;
+    const char* names_;
+};
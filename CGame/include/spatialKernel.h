@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+/**
+ * @brief Allocator of arrays aligned for the widest vector registers used (32 bytes, AVX).
+ */
+template <typename T>
+struct AlignedAllocator {
+    using value_type = T;
+    static const size_t kAlignment = 32;
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(kAlignment)));
+    }
+    void deallocate(T* pointer, size_t) {
+        ::operator delete(pointer, std::align_val_t(kAlignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+/**
+ * @brief 2D emitters laid out one array per field, as SpatialKernel reads and writes them.
+ */
+struct EmitterArrays {
+    std::vector<int> id;             /**< Owner's id of each emitter. */
+    AlignedVector<float> x, y;       /**< World position. */
+    AlignedVector<float> maxDistance;
+    AlignedVector<float> gain;       /**< Distance attenuation in [0, 1], written by SpatialKernel. */
+    AlignedVector<float> pan;        /**< Lateral position in [-1, 1], written by SpatialKernel. */
+
+    int Size() const { return static_cast<int>(id.size()); }
+    void Clear();
+    void Push(int emitter, float emitterX, float emitterY, float range);
+};
+
+/**
+ * @brief Distance gain and panning of many 2D emitters at once.
+ *
+ * The math is that of AudioManager's single-emitter Attenuate2D: gain falls
+ * linearly from 1 at the listener to 0 at maxDistance, and the panning is
+ * the X offset over maxDistance. Only correctly rounded operations are used
+ * (no reciprocal or square root estimates), so every level gives the same
+ * results bit for bit. The level is picked once from what the CPU supports.
+ */
+class SpatialKernel {
+public:
+    enum Level : uint8_t {
+        kScalar, /**< One emitter at a time; the only level off x86. */
+        kSse,    /**< 4 emitters per instruction; always available on x86-64. */
+        kAvx2,   /**< 8 emitters per instruction. */
+    };
+
+    static Level Detect();
+    static const char* Name(Level level);
+    static void Attenuate(EmitterArrays& emitters, float listenerX, float listenerY);
+    static void Attenuate(EmitterArrays& emitters, float listenerX, float listenerY, Level level);
+};
@@ -0,0 +1,70 @@
+/**
+ * @file audioStats.cpp
+ * @brief Load latency histogram and text dump of AudioStats.
+ */
+
+#include <audioStats.h>
+#include <algorithm>
+
+std::atomic<uint64_t> AudioStats::alCallCounter_(0);
+
+/** @brief Upper limit of the first load latency bucket, in milliseconds; each next one doubles it. */
+static const float kFirstLoadBucketMs = 0.25f;
+
+/**
+ * @brief Returns the upper limit of a load latency bucket, in milliseconds.
+ *
+ * Bucket 0 holds loads under 0.25 ms, and each bucket doubles the limit of
+ * the one before. The last bucket has no limit and also takes everything slower.
+ */
+float AudioStats::LoadBucketLimit(int bucket) {
+    return kFirstLoadBucketMs * static_cast<float>(1 << bucket);
+}
+
+/**
+ * @brief Starts counting a new tick: closes the AL call count of the previous one.
+ *
+ * The first tick has no previous one and reports 0 calls, rather than
+ * everything Init did.
+ */
+void AudioStats::BeginTick() {
+    uint64_t total = AlCallCount();
+    alCallsLastTick = ticks > 0 ? static_cast<uint32_t>(total - alCalls) : 0;
+    alCallsMaxTick = std::max(alCallsMaxTick, alCallsLastTick);
+    alCalls = total;
+    ticks++;
+}
+
+/**
+ * @brief Counts a load that was requested at the given time and is now uploaded.
+ */
+void AudioStats::AddLoad(std::chrono::steady_clock::time_point requested) {
+    float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - requested).count();
+    int bucket = 0;
+    while (bucket < kLoadBuckets - 1 && ms >= LoadBucketLimit(bucket)) bucket++;
+    loadLatency[bucket]++;
+}
+
+/**
+ * @brief Prints the stats as readable text, one figure per line.
+ */
+void AudioStats::Dump(std::ostream& out) const {
+    out << "voices: " << activeVoices << " active, " << virtualVoices << " virtual\n";
+    out << "fades: " << fades << "\n";
+    out << "resident PCM: " << residentBytes / 1024 << " KB\n";
+    if (!kEnabled) {
+        out << "(tick counters need AUDIO_STATS)" << std::endl;
+        return;
+    }
+
+    out << "ticks: " << ticks << "\n";
+    out << "AL calls: " << alCallsLastTick << " last tick, " << alCallsMaxTick << " peak, " << alCalls << " total\n";
+    out << "Update: " << updateMicros << " us, " << updateMaxMicros << " us peak\n";
+    out << "UpdateSpatial2D: " << spatialMicros << " us, " << spatialMaxMicros << " us peak\n";
+    out << "load latency:";
+    for (int bucket = 0; bucket < kLoadBuckets; bucket++) {
+        if (bucket < kLoadBuckets - 1) out << " <" << LoadBucketLimit(bucket) << "ms:" << loadLatency[bucket];
+        else out << " more:" << loadLatency[bucket];
+    }
+    out << std::endl;
+}
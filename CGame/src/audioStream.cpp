@@ -0,0 +1,312 @@
+/**
+ * @file audioStream.cpp
+ * @brief Implementation of buffer-queue streaming for long WAV tracks.
+ *
+ * The reader side (FillBlocks) only touches the file and the staging blocks.
+ * The OpenAL side (Start, Stop, Service) must run on the thread that owns the
+ * OpenAL context. Both sides meet in the staging ring under the stream mutex,
+ * which the reader never holds while it reads the file.
+ */
+
+#include <audioStream.h>
+#include <alCheck.h>
+#include <sampleConvert.h>
+
+/**
+ * @brief Constructs a closed stream.
+ */
+AudioStream::AudioStream()
+    : headRead_(0), format_(0), encoding_(kWavUnsupported), convert_(false), sampleRate_(0), blockBytes_(0),
+    dataOffset_(0), dataSize_(0), cursor_(0),
+    fillBlock_(0), uploadBlock_(0), loop_(true), active_(false), eof_(false), generation_(0) {
+    for (auto& b : buffers_) b = 0;
+}
+
+/**
+ * @brief Destructor. Deletes the OpenAL buffer ring.
+ *
+ * The stream must have been stopped first so none of its buffers is still
+ * queued on a source.
+ */
+AudioStream::~AudioStream() {
+    Close();
+}
+
+/**
+ * @brief Opens a WAV file for streaming.
+ *
+ * The header is located by mapping the file and walking its chunks, after
+ * which the mapping is dropped and the samples are read block by block.
+ * Samples OpenAL cannot take as they are are converted block by block as
+ * they are read (see SampleConvert). The first block is read here, so that
+ * Start can queue it without touching the file.
+ *
+ * @param filename The path to the WAV file.
+ * @param floatFormats True if the device has AL_EXT_FLOAT32.
+ * @return True if the file is a supported WAV, false otherwise.
+ */
+bool AudioStream::Open(const std::string& filename, bool floatFormats) {
+    WavInfo info;
+    {
+        MappedFile header;
+        if (!header.Open(filename)) return false;
+        if (!ParseWav(header.Data(), header.Size(), &info)) return false;
+        dataOffset_ = static_cast<size_t>(info.samples - header.Data());
+    }
+
+    file_.open(filename, std::ios::binary);
+    if (!file_) return false;
+
+    format_ = SampleConvert::TargetFormat(info, floatFormats);
+    encoding_ = info.encoding;
+    convert_ = format_ != info.format;
+    sampleRate_ = info.sampleRate;
+    dataSize_ = info.dataSize;
+
+    // Never split a sample frame across two buffers
+    size_t frameBytes = static_cast<size_t>(info.numChannels) * SampleConvert::SampleBytes(encoding_);
+    blockBytes_ = kBlockSize - kBlockSize % frameBytes;
+    size_t uploadBytes = convert_ ? SampleConvert::TargetSize(encoding_, blockBytes_, format_) : blockBytes_;
+    for (auto& b : blocks_) b.data.resize(uploadBytes);
+    spare_.resize(uploadBytes);
+    raw_.resize(convert_ ? blockBytes_ : 0);
+
+    head_.resize(uploadBytes);
+    headRead_ = ReadSamples(0, dataSize_ < blockBytes_ ? dataSize_ : blockBytes_, head_);
+    if (headRead_ == 0) return false;
+    head_.resize(convert_ ? SampleConvert::TargetSize(encoding_, headRead_, format_) : headRead_);
+
+    AL_CALL(alGenBuffers(kBufferCount, buffers_));
+    idle_.assign(buffers_, buffers_ + kBufferCount);
+    return true;
+}
+
+/**
+ * @brief Picks the part of the track the next staging block holds.
+ *
+ * Wraps to the start of the data when looping. The caller must hold mutex_.
+ *
+ * @param offset Receives the position of the block, relative to the start of the data.
+ * @param count Receives the number of bytes to read.
+ * @return True if there is a free block to fill, false if the ring is full or the track ended.
+ */
+bool AudioStream::NextRange(size_t* offset, size_t* count) {
+    if (blocks_[fillBlock_].ready || eof_) return false;
+
+    if (cursor_ >= dataSize_) {
+        if (!loop_) {
+            eof_ = true;
+            return false;
+        }
+        cursor_ = 0;
+    }
+
+    size_t remaining = dataSize_ - cursor_;
+    *offset = cursor_;
+    *count = remaining < blockBytes_ ? remaining : blockBytes_;
+    return true;
+}
+
+/**
+ * @brief Reads samples from the file, converting them if needed.
+ *
+ * Only the thread calling FillBlocks (or Open, before that) reads the file,
+ * so this needs no lock.
+ *
+ * @param offset The position to read from, relative to the start of the data.
+ * @param count The number of bytes to read, a whole number of sample frames.
+ * @param out Receives the samples in the upload format; sized for a whole block.
+ * @return The number of bytes read from the file, 0 if it is truncated there.
+ */
+size_t AudioStream::ReadSamples(size_t offset, size_t count, std::vector<char>& out) {
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(dataOffset_ + offset));
+    file_.read(convert_ ? raw_.data() : out.data(), static_cast<std::streamsize>(count));
+    count = static_cast<size_t>(file_.gcount());
+
+    if (convert_ && count > 0) {
+        SampleConvert::Convert(encoding_, reinterpret_cast<const unsigned char*>(raw_.data()), count, format_,
+            out.data());
+    }
+    return count;
+}
+
+/**
+ * @brief Fills every free staging block. Called from the background reader.
+ *
+ * The file is read into a spare block without holding mutex_, so the thread
+ * servicing the stream never waits for the disk; the lock is only taken to
+ * pick the next range and to swap the filled block into the ring. A block
+ * read across a Start is dropped.
+ */
+void AudioStream::FillBlocks() {
+    for (;;) {
+        size_t offset, count;
+        unsigned generation;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!active_ || !NextRange(&offset, &count)) return;
+            generation = generation_;
+        }
+
+        size_t read = ReadSamples(offset, count, spare_);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (generation != generation_) continue;
+        if (read == 0) {
+            eof_ = true; // Truncated file
+            return;
+        }
+
+        Block& block = blocks_[fillBlock_];
+        block.data.swap(spare_);
+        block.size = convert_ ? SampleConvert::TargetSize(encoding_, read, format_) : read;
+        block.ready = true;
+        cursor_ = offset + read;
+        fillBlock_ = (fillBlock_ + 1) % kBufferCount;
+    }
+}
+
+/**
+ * @brief Uploads ready staging blocks into idle OpenAL buffers and queues them.
+ *
+ * The caller must hold mutex_.
+ *
+ * @param source The OpenAL source playing this stream.
+ * @return The number of blocks consumed.
+ */
+int AudioStream::UploadBlocks(ALuint source) {
+    int uploaded = 0;
+    while (!idle_.empty() && blocks_[uploadBlock_].ready) {
+        Block& block = blocks_[uploadBlock_];
+        ALuint buffer = idle_.back();
+        idle_.pop_back();
+
+        AL_CALL(alBufferData(buffer, format_, block.data.data(), static_cast<ALsizei>(block.size), sampleRate_));
+        AL_CALL(alSourceQueueBuffers(source, 1, &buffer));
+
+        block.ready = false;
+        uploadBlock_ = (uploadBlock_ + 1) % kBufferCount;
+        uploaded++;
+    }
+    return uploaded;
+}
+
+/**
+ * @brief Restarts the stream from the beginning on the given source.
+ *
+ * Never reads the file: the first block, read by Open, is queued so playback
+ * starts immediately, and the background reader goes on from the next one
+ * (wake it up after calling this).
+ *
+ * @param source The OpenAL source to play the stream on.
+ * @param loop If true, the stream wraps to the start instead of ending.
+ */
+void AudioStream::Start(ALuint source, bool loop) {
+    Stop(source);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    loop_ = loop;
+    cursor_ = headRead_;
+    eof_ = false;
+    fillBlock_ = 0;
+    uploadBlock_ = 0;
+    generation_++;
+    for (auto& b : blocks_) b.ready = false;
+
+    // Looping is done by rewinding the file, never by the source itself
+    AL_CALL(alSourcei(source, AL_LOOPING, AL_FALSE));
+    ALuint buffer = idle_.back();
+    idle_.pop_back();
+    AL_CALL(alBufferData(buffer, format_, head_.data(), static_cast<ALsizei>(head_.size()), sampleRate_));
+    AL_CALL(alSourceQueueBuffers(source, 1, &buffer));
+    AL_CALL(alSourcePlay(source));
+    active_ = true;
+}
+
+/**
+ * @brief Stops playback and takes every buffer back from the source queue.
+ *
+ * @param source The OpenAL source playing this stream.
+ */
+void AudioStream::Stop(ALuint source) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        active_ = false;
+    }
+
+    AL_CALL(alSourceStop(source));
+
+    // A stopped source reports all of its queued buffers as processed
+    ALint queued = 0;
+    AL_CALL(alGetSourcei(source, AL_BUFFERS_QUEUED, &queued));
+    while (queued-- > 0) {
+        ALuint buffer;
+        AL_CALL(alSourceUnqueueBuffers(source, 1, &buffer));
+        idle_.push_back(buffer);
+    }
+}
+
+/**
+ * @brief Deletes the buffer ring, after Stop gave it back.
+ *
+ * Lets the thread that owns the OpenAL context release the buffers while the
+ * background reader may still hold the stream, which is then only memory.
+ */
+void AudioStream::Close() {
+    if (buffers_[0] == 0) return;
+    AL_CALL(alDeleteBuffers(kBufferCount, buffers_));
+    for (auto& b : buffers_) b = 0;
+    idle_.clear();
+}
+
+/**
+ * @brief Recycles finished buffers and refills them from the staging ring.
+ *
+ * Must be called regularly (AudioManager::Update does it). Restarts the
+ * source if it ran dry while data was late, and marks the stream inactive
+ * once a non-looping track has fully played.
+ *
+ * @param source The OpenAL source playing this stream.
+ * @return The number of staging blocks consumed, so the caller can wake the reader.
+ */
+int AudioStream::Service(ALuint source) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!active_) return 0;
+
+    ALint processed = 0;
+    AL_CALL(alGetSourcei(source, AL_BUFFERS_PROCESSED, &processed));
+    while (processed-- > 0) {
+        ALuint buffer;
+        AL_CALL(alSourceUnqueueBuffers(source, 1, &buffer));
+        idle_.push_back(buffer);
+    }
+
+    int uploaded = UploadBlocks(source);
+
+    ALint state = 0, queued = 0;
+    AL_CALL(alGetSourcei(source, AL_SOURCE_STATE, &state));
+    AL_CALL(alGetSourcei(source, AL_BUFFERS_QUEUED, &queued));
+    if (state != AL_PLAYING) {
+        if (queued > 0) AL_CALL(alSourcePlay(source)); // Recover from an underrun
+        else if (eof_) active_ = false;        // Track finished
+    }
+
+    return uploaded;
+}
+
+/**
+ * @brief Returns true while the stream is playing or waiting for data.
+ */
+bool AudioStream::IsActive() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return active_;
+}
+
+/**
+ * @brief Returns the loop flag used by the last Start.
+ */
+bool AudioStream::IsLooping() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return loop_;
+}
@@ -0,0 +1,202 @@
+/**
+ * @file fadeManager.cpp
+ * @brief Concurrent gain ramps stored as structure-of-arrays.
+ *
+ * The helpers below avoid std::sin, std::exp2 and even std::min, all of which
+ * keep the compiler from vectorizing Advance (the comparisons because they may
+ * trap on NaN, so the loop cannot be made branch-free).
+ */
+
+#include <fadeManager.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/** @brief Gain treated as silence by kExponential ramps (-60 dB). */
+static const float kSilenceGain = 0.001f;
+
+/** @brief Rate of zero-length ramps: finite, so the branch-free clamps stay exact. */
+static const float kInstantRate = 1e6f;
+
+/**
+ * @brief Branch-free minimum of two finite values.
+ */
+static inline float Min(float a, float b) {
+    return 0.5f * (a + b - std::fabs(a - b));
+}
+
+/**
+ * @brief Branch-free maximum of two finite values.
+ */
+static inline float Max(float a, float b) {
+    return 0.5f * (a + b + std::fabs(a - b));
+}
+
+/**
+ * @brief sin(u * pi / 2) for u in [0, 1], within 7e-5.
+ */
+static inline float SinQuarter(float u) {
+    float x = u * 1.5707963f;
+    float x2 = x * x;
+    return x * (0.9996949f - x2 * (0.1656700f - x2 * 0.0075134f));
+}
+
+/**
+ * @brief 2^x for x in [-126, 127], within 1.1e-4 relative.
+ *
+ * The integer part goes straight into the exponent bits, the fraction through
+ * a cubic that is exact at both ends.
+ */
+static inline float Exp2(float x) {
+    x = Min(Max(x, -126.0f), 127.0f);
+    int32_t whole = static_cast<int32_t>(x + 128.0f) - 128; // Truncation of a positive value: floor
+    float f = x - static_cast<float>(whole);
+    float p = 1.0f + f * (0.6954f + f * (0.2264f + f * 0.0782f));
+    int32_t bits = (whole + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+/**
+ * @brief Advances count ramps and writes their gains.
+ *
+ * All three curves are evaluated for every ramp and blended with the 0/1
+ * curve weights, so the loop has no branches. It takes the arrays as restrict
+ * parameters because restrict locals are not enough for the vectorizer.
+ */
+static void AdvanceRamps(int count, float deltaTime, float* __restrict elapsed, const float* __restrict rate,
+    const float* __restrict from, const float* __restrict delta, const float* __restrict logFrom,
+    const float* __restrict logDelta, const float* __restrict rising, const float* __restrict linear,
+    const float* __restrict power, const float* __restrict exponential, float* __restrict gain) {
+    for (int i = 0; i < count; i++) {
+        elapsed[i] += deltaTime;
+        float t = Min(elapsed[i] * rate[i], 1.0f);
+
+        // Equal power: sin for rising ramps, 1 - cos for falling ones, so a pair sums to unit power
+        float r = rising[i];
+        float s = SinQuarter((1.0f - t) + r * (2.0f * t - 1.0f));
+        float shape = (1.0f - s) + r * (2.0f * s - 1.0f);
+
+        float linearGain = from[i] + delta[i] * t;
+        float powerGain = from[i] + delta[i] * shape;
+        float exponentialGain = Exp2(logFrom[i] + logDelta[i] * t);
+        gain[i] = linear[i] * linearGain + power[i] * powerGain + exponential[i] * exponentialGain;
+    }
+}
+
+/**
+ * @brief Starts a ramp on a target, replacing the one it already has.
+ *
+ * @param target The id whose gain is driven.
+ * @param from The gain at the start, usually the target's current gain.
+ * @param to The gain at the end.
+ * @param duration The length of the ramp in seconds; 0 or less ends on the next Advance.
+ * @param curve The shape of the ramp.
+ * @param action Reported with the completion, for the owner to carry out.
+ */
+void FadeManager::Start(int target, float from, float to, float duration, Curve curve, Action action) {
+    int ramp = Find(target);
+    if (ramp < 0) {
+        ramp = Size();
+        for (auto* field : { &elapsed_, &rate_, &from_, &delta_, &logFrom_, &logDelta_, &rising_,
+            &linear_, &power_, &exponential_, &gain_, &to_ }) {
+            field->push_back(0.0f);
+        }
+        target_.push_back(target);
+        action_.push_back(kNone);
+        if (target >= static_cast<int>(rampOf_.size())) rampOf_.resize(target + 1, -1);
+        rampOf_[target] = ramp;
+    }
+
+    elapsed_[ramp] = 0.0f;
+    rate_[ramp] = duration > 1.0f / kInstantRate ? 1.0f / duration : kInstantRate;
+    from_[ramp] = from;
+    delta_[ramp] = to - from;
+    logFrom_[ramp] = std::log2(std::max(from, kSilenceGain));
+    logDelta_[ramp] = std::log2(std::max(to, kSilenceGain)) - logFrom_[ramp];
+    rising_[ramp] = to >= from ? 1.0f : 0.0f;
+    linear_[ramp] = curve == kLinear ? 1.0f : 0.0f;
+    power_[ramp] = curve == kEqualPower ? 1.0f : 0.0f;
+    exponential_[ramp] = curve == kExponential ? 1.0f : 0.0f;
+    gain_[ramp] = from;
+    to_[ramp] = to;
+    action_[ramp] = action;
+}
+
+/**
+ * @brief Drops the ramp of a target, leaving its gain where it is.
+ *
+ * @return True if the target had a ramp.
+ */
+bool FadeManager::Cancel(int target) {
+    int ramp = Find(target);
+    if (ramp < 0) return false;
+    RemoveAt(ramp);
+    return true;
+}
+
+/**
+ * @brief Returns true while a target has a ramp.
+ */
+bool FadeManager::IsFading(int target) const {
+    return Find(target) >= 0;
+}
+
+/**
+ * @brief Moves every ramp forward and computes its gain.
+ *
+ * Ramps that reach their end are then removed and listed in Completed, with
+ * their exact end gain.
+ *
+ * @param deltaTime The time elapsed since the last Advance, in seconds.
+ */
+void FadeManager::Advance(float deltaTime) {
+    completed_.clear();
+    const int count = Size();
+    AdvanceRamps(count, deltaTime, elapsed_.data(), rate_.data(), from_.data(), delta_.data(),
+        logFrom_.data(), logDelta_.data(), rising_.data(), linear_.data(), power_.data(),
+        exponential_.data(), gain_.data());
+
+    // Backwards, so removing a ramp (swapping the last one in) never skips another
+    for (int i = count - 1; i >= 0; i--) {
+        if (elapsed_[i] * rate_[i] < 1.0f) continue;
+        completed_.push_back({ target_[i], to_[i], action_[i] });
+        RemoveAt(i);
+    }
+}
+
+/**
+ * @brief Drops every ramp.
+ */
+void FadeManager::Clear() {
+    while (Size() > 0) RemoveAt(Size() - 1);
+    completed_.clear();
+}
+
+/**
+ * @brief Returns the ramp index of a target, or -1 if it has none.
+ */
+int FadeManager::Find(int target) const {
+    if (target < 0 || target >= static_cast<int>(rampOf_.size())) return -1;
+    return rampOf_[target];
+}
+
+/**
+ * @brief Removes a ramp by moving the last one into its place.
+ */
+void FadeManager::RemoveAt(int ramp) {
+    int last = Size() - 1;
+    rampOf_[target_[ramp]] = -1;
+    if (ramp != last) rampOf_[target_[last]] = ramp;
+
+    for (auto* field : { &elapsed_, &rate_, &from_, &delta_, &logFrom_, &logDelta_, &rising_,
+        &linear_, &power_, &exponential_, &gain_, &to_ }) {
+        (*field)[ramp] = (*field)[last];
+        field->pop_back();
+    }
+    target_[ramp] = target_[last];
+    target_.pop_back();
+    action_[ramp] = action_[last];
+    action_.pop_back();
+}
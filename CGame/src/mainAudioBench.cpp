@@ -0,0 +1,360 @@
+/**
+ * @file mainAudioBench.cpp
+ * @brief Benchmark of the AudioManager hot paths, reported as JSON.
+ *
+ * Usage: AudioBench [output.json]
+ *
+ * Runs on a loopback device (see AudioManager::InitLoopback), so it needs no
+ * sound card and is not paced by one; without ALC_SOFT_loopback it falls back
+ * to the default device. Measures:
+ *  - LoadWav throughput across file sizes (files are in the OS cache after
+ *    the first load, so this is parse + upload, not disk speed);
+ *  - SampleConvert throughput of every conversion at every level the CPU has;
+ *  - UpdateSpatial2D and Update cost per tick from 10 to 100k emitters;
+ *  - Update cost per tick with crossfades running;
+ *  - voice allocation and release churn through PlayOneShot and StopVoice.
+ *
+ * The JSON goes to the given file, or to stdout. Timings are wall-clock
+ * microseconds (nanoseconds for churn), so compare runs on the same machine.
+ * OpenAL call counts are exact and comparable anywhere; the target is built
+ * with AUDIO_STATS so they are always there.
+ */
+
+#include <sound.h>
+#include <audioStats.h>
+#include <sampleConvert.h>
+#include <spatialKernel.h>
+#include <wavFile.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+static const int kTicks = 300;            /**< Measured ticks per case. */
+static const int kWarmupTicks = 10;       /**< Ticks run before measuring, so voices and caches settle. */
+static const float kTickTime = 1.0f / 60.0f;
+static const int kSampleRate = 44100;     /**< Rate of the generated WAV files. */
+
+/** @brief Spread of a set of per-tick timings. */
+struct Timing {
+    double mean = 0.0;
+    double median = 0.0;
+    double p99 = 0.0;
+};
+
+/**
+ * @brief Returns the microseconds elapsed since a time point.
+ */
+static double MicrosecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Summarizes a set of timings; the samples are reordered.
+ */
+static Timing Summarize(std::vector<double>& samples) {
+    Timing timing;
+    if (samples.empty()) return timing;
+    std::sort(samples.begin(), samples.end());
+    for (double sample : samples) timing.mean += sample;
+    timing.mean /= samples.size();
+    timing.median = samples[samples.size() / 2];
+    timing.p99 = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    return timing;
+}
+
+/**
+ * @brief Prints a timing as a JSON object.
+ */
+static void PrintTiming(FILE* out, const char* name, const Timing& timing) {
+    std::fprintf(out, "\"%s\": { \"mean\": %.3f, \"median\": %.3f, \"p99\": %.3f }",
+        name, timing.mean, timing.median, timing.p99);
+}
+
+/**
+ * @brief Returns the OpenAL calls made since a count taken with AudioStats::AlCallCount, per step.
+ */
+static double AlCallsSince(uint64_t start, int steps) {
+    return static_cast<double>(AudioStats::AlCallCount() - start) / steps;
+}
+
+/**
+ * @brief Writes a 16-bit stereo tone of roughly the given size.
+ */
+static bool WriteTone(const std::string& filename, size_t bytes) {
+    WavWriter writer;
+    if (!writer.Open(filename, 2, kSampleRate)) return false;
+
+    std::vector<int16_t> block(4096);
+    size_t frames = bytes / 4;
+    size_t frame = 0;
+    while (frame < frames) {
+        size_t count = std::min(block.size() / 2, frames - frame);
+        for (size_t i = 0; i < count; i++, frame++) {
+            auto sample = static_cast<int16_t>(8000.0 * std::sin(frame * 2.0 * 3.14159265358979 * 440.0 / kSampleRate));
+            block[2 * i] = sample;
+            block[2 * i + 1] = sample;
+        }
+        writer.Write(block.data(), count * 2);
+    }
+    return writer.Close();
+}
+
+/**
+ * @brief Initializes the audio manager, on a loopback device when possible.
+ *
+ * @return The name of the device used, or nullptr if none could be opened.
+ */
+static const char* Open(AudioManager& audio) {
+    if (audio.InitLoopback()) return "loopback";
+    if (audio.Init()) return "default";
+    return nullptr;
+}
+
+/**
+ * @brief Measures LoadWav (and the Unload that follows) across file sizes.
+ */
+static void BenchLoad(FILE* out, const std::filesystem::path& directory) {
+    const size_t sizes[] = { 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+    const size_t kBytesPerSize = 256 * 1024 * 1024;
+
+    AudioManager audio;
+    Open(audio);
+    std::fprintf(out, "  \"load_wav\": [\n");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        std::string filename = (directory / ("load" + std::to_string(i) + ".wav")).string();
+        WriteTone(filename, sizes[i]);
+        size_t repeats = std::max<size_t>(4, kBytesPerSize / sizes[i]);
+
+        // Loading again after Unload reads the file anew, since the cached buffer was released
+        std::vector<double> samples;
+        for (size_t repeat = 0; repeat < repeats; repeat++) {
+            auto start = std::chrono::steady_clock::now();
+            SoundHandle sound = audio.LoadWav(filename);
+            audio.Unload(sound);
+            samples.push_back(MicrosecondsSince(start));
+        }
+        Timing timing = Summarize(samples);
+        std::fprintf(out, "    { \"bytes\": %zu, \"mb_per_s\": %.1f, ", sizes[i], sizes[i] / timing.median);
+        PrintTiming(out, "us", timing);
+        std::fprintf(out, " }%s\n", i + 1 < sizeof(sizes) / sizeof(sizes[0]) ? "," : "");
+    }
+    std::fprintf(out, "  ],\n");
+    audio.Close();
+}
+
+/**
+ * @brief Measures SampleConvert on 16 MB of samples already in memory, per conversion and level.
+ */
+static void BenchConvert(FILE* out) {
+    struct Case {
+        WavEncoding encoding;
+        const char* from;
+        ALenum format;
+        const char* to;
+    };
+    const Case cases[] = {
+        { kWavPcm24, "pcm24", AL_FORMAT_MONO16, "pcm16" },
+        { kWavPcm32, "pcm32", AL_FORMAT_MONO16, "pcm16" },
+        { kWavFloat32, "float32", AL_FORMAT_MONO16, "pcm16" },
+        { kWavPcm24, "pcm24", AL_FORMAT_MONO_FLOAT32, "float32" },
+        { kWavPcm32, "pcm32", AL_FORMAT_MONO_FLOAT32, "float32" },
+    };
+    const size_t kBytes = 16 * 1024 * 1024;
+    const int kRepeats = 20;
+
+    // Quiet random noise: every value is an ordinary sample for all three encodings
+    std::vector<unsigned char> samples(kBytes);
+    std::mt19937 random(1);
+    for (size_t i = 0; i < kBytes; i++) samples[i] = static_cast<unsigned char>(i % 4 == 3 ? 0x3C : random());
+    std::vector<unsigned char> converted(SampleConvert::TargetSize(kWavPcm24, kBytes, AL_FORMAT_MONO_FLOAT32)); // The largest output
+
+    int levels = SpatialKernel::Detect() + 1;
+    int count = static_cast<int>(sizeof(cases) / sizeof(cases[0])) * levels;
+    std::fprintf(out, "  \"convert\": [\n");
+    for (int i = 0; i < count; i++) {
+        const Case& c = cases[i / levels];
+        auto level = static_cast<SpatialKernel::Level>(i % levels);
+        std::vector<double> times;
+        for (int repeat = 0; repeat < kRepeats; repeat++) {
+            auto start = std::chrono::steady_clock::now();
+            SampleConvert::Convert(c.encoding, samples.data(), kBytes, c.format, converted.data(), level);
+            times.push_back(MicrosecondsSince(start));
+        }
+        Timing timing = Summarize(times);
+        std::fprintf(out, "    { \"from\": \"%s\", \"to\": \"%s\", \"level\": \"%s\", \"mb_per_s\": %.1f }%s\n",
+            c.from, c.to, SpatialKernel::Name(level), kBytes / timing.median, i + 1 < count ? "," : "");
+    }
+    std::fprintf(out, "  ],\n");
+}
+
+/**
+ * @brief Measures UpdateSpatial2D and Update with a growing number of looping emitters.
+ *
+ * Emitters are scattered over a 1000x1000 map with ranges of 20 to 60 units,
+ * and the listener walks a circle, so only a handful are heard at a time, as
+ * in a crowded level.
+ */
+static void BenchSpatial(FILE* out, const std::string& filename) {
+    const int counts[] = { 10, 100, 1000, 10000, 100000 };
+
+    std::fprintf(out, "  \"spatial\": [\n");
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        AudioManager audio;
+        Open(audio);
+
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> range(20.0f, 60.0f);
+        for (int emitter = 0; emitter < counts[i]; emitter++) {
+            SoundHandle sound = audio.LoadWav(filename);
+            audio.Register2DSound(sound, position(random), position(random), range(random));
+            audio.Play(sound, true);
+        }
+
+        std::vector<double> spatial, update;
+        uint64_t calls = 0;
+        for (int tick = -kWarmupTicks; tick < kTicks; tick++) {
+            if (tick == 0) calls = AudioStats::AlCallCount();
+            float angle = tick * 0.01f;
+            auto start = std::chrono::steady_clock::now();
+            audio.UpdateSpatial2D(100.0f * std::cos(angle), 100.0f * std::sin(angle));
+            double spatialTime = MicrosecondsSince(start);
+            start = std::chrono::steady_clock::now();
+            audio.Update(kTickTime);
+            double updateTime = MicrosecondsSince(start);
+            if (tick < 0) continue;
+            spatial.push_back(spatialTime);
+            update.push_back(updateTime);
+        }
+
+        std::fprintf(out, "    { \"emitters\": %d, \"al_calls_per_tick\": %.1f, ", counts[i], AlCallsSince(calls, kTicks));
+        PrintTiming(out, "update_spatial_us", Summarize(spatial));
+        std::fprintf(out, ", ");
+        PrintTiming(out, "update_us", Summarize(update));
+        std::fprintf(out, " }%s\n", i + 1 < sizeof(counts) / sizeof(counts[0]) ? "," : "");
+        audio.Close();
+    }
+    std::fprintf(out, "  ],\n");
+}
+
+/**
+ * @brief Measures Update while a number of crossfades are running.
+ *
+ * The fades are long enough to last the whole measurement.
+ */
+static void BenchCrossfade(FILE* out, const std::string& filename) {
+    const int pairs[] = { 0, 1, 16, 64 };
+
+    std::fprintf(out, "  \"crossfade\": [\n");
+    for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+        AudioManager audio;
+        Open(audio);
+        for (int pair = 0; pair < pairs[i]; pair++) {
+            SoundHandle from = audio.LoadWav(filename);
+            SoundHandle to = audio.LoadWav(filename);
+            audio.Play(from, true);
+            audio.Crossfade(from, to, 1000.0f);
+        }
+
+        std::vector<double> update;
+        uint64_t calls = 0;
+        for (int tick = -kWarmupTicks; tick < kTicks; tick++) {
+            if (tick == 0) calls = AudioStats::AlCallCount();
+            auto start = std::chrono::steady_clock::now();
+            audio.Update(kTickTime);
+            if (tick >= 0) update.push_back(MicrosecondsSince(start));
+        }
+
+        std::fprintf(out, "    { \"pairs\": %d, \"al_calls_per_tick\": %.1f, ", pairs[i], AlCallsSince(calls, kTicks));
+        PrintTiming(out, "update_us", Summarize(update));
+        std::fprintf(out, " }%s\n", i + 1 < sizeof(pairs) / sizeof(pairs[0]) ? "," : "");
+        audio.Close();
+    }
+    std::fprintf(out, "  ],\n");
+}
+
+/**
+ * @brief Measures voice allocation and release through one-shots.
+ *
+ * Each tick starts more one-shots than the pool holds, so the later ones
+ * steal voices from the earlier ones, then stops them all.
+ */
+static void BenchChurn(FILE* out, const std::string& filename) {
+    const int kOneShotsPerTick = AudioManager::kDefaultVoices * 3 / 2;
+
+    AudioManager audio;
+    Open(audio);
+    SoundHandle sound = audio.LoadWav(filename);
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-5.0f, 5.0f);
+    std::vector<VoiceHandle> voices(kOneShotsPerTick);
+
+    std::vector<double> churn;
+    uint64_t calls = 0;
+    for (int tick = -kWarmupTicks; tick < kTicks; tick++) {
+        if (tick == 0) calls = AudioStats::AlCallCount();
+        auto start = std::chrono::steady_clock::now();
+        for (VoiceHandle& voice : voices) {
+            voice = audio.PlayOneShot(sound, position(random), position(random), 0.1f, 0.1f);
+        }
+        audio.Update(kTickTime);
+        for (VoiceHandle voice : voices) audio.StopVoice(voice);
+        audio.Update(kTickTime);
+        if (tick >= 0) churn.push_back(MicrosecondsSince(start) * 1000.0 / kOneShotsPerTick);
+    }
+
+    std::fprintf(out, "  \"voice_churn\": { \"voices\": %d, \"oneshots_per_tick\": %d, \"al_calls_per_oneshot\": %.1f, ",
+        AudioManager::kDefaultVoices, kOneShotsPerTick, AlCallsSince(calls, kTicks * kOneShotsPerTick));
+    Timing timing = Summarize(churn);
+    PrintTiming(out, "ns_per_oneshot", timing);
+    std::fprintf(out, " }\n");
+    audio.Close();
+}
+
+int main(int argc, char** argv) {
+    FILE* out = stdout;
+    if (argc > 1) {
+        out = std::fopen(argv[1], "w");
+        if (!out) {
+            std::fprintf(stderr, "Could not write %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    const char* device = nullptr;
+    {
+        AudioManager probe;
+        device = Open(probe);
+    }
+    if (!device) {
+        std::fprintf(stderr, "No audio device\n");
+        return 1;
+    }
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "AudioBench";
+    std::filesystem::create_directories(directory);
+    std::string tone = (directory / "tone.wav").string();
+    WriteTone(tone, 256 * 1024);
+
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"device\": \"%s\",\n", device);
+    std::fprintf(out, "  \"spatial_kernel\": \"%s\",\n", SpatialKernel::Name(SpatialKernel::Detect()));
+    std::fprintf(out, "  \"ticks\": %d,\n", kTicks);
+    BenchLoad(out, directory);
+    BenchConvert(out);
+    BenchSpatial(out, tone);
+    BenchCrossfade(out, tone);
+    BenchChurn(out, tone);
+    std::fprintf(out, "}\n");
+
+    if (out != stdout) std::fclose(out);
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    return 0;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file mainBankBuilder.cpp
+ * @brief Offline tool that packs a directory of WAV files into one sound bank.
+ *
+ * Usage: BankBuilder <assets directory> <output bank> [excluded sound...]
+ *
+ * Every .wav below the directory is parsed and validated here, once, so the
+ * game only has to map the bank and look sounds up by name (see SoundBank and
+ * AudioManager::LoadBank). A sound's name is its path relative to the
+ * directory, with forward slashes and without extension (e.g. "dinoStepMono").
+ * Sounds named on the command line after the output bank are left out: music
+ * the game streams (e.g. "fondo") would only make the bank larger.
+ *
+ * Files OpenAL has no core format for (24 and 32-bit integers, floats) are
+ * stored as 16-bit PCM, so a bank plays on any device.
+ */
+
+#include <sampleConvert.h>
+#include <soundBank.h>
+#include <wavFile.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+/** @brief A validated WAV file waiting to be written into the bank. */
+struct PackedSound {
+    std::string name;
+    MappedFile file;
+    WavInfo info;                         /**< Describes the converted samples, if there are any. */
+    std::vector<unsigned char> converted; /**< The samples reduced to 16-bit, for files with no core format. */
+};
+
+/**
+ * @brief Rounds an offset up to the next multiple of the bank alignment.
+ */
+static uint64_t AlignUp(uint64_t offset) {
+    return (offset + kBankAlignment - 1) & ~(kBankAlignment - 1);
+}
+
+/**
+ * @brief Writes zero bytes until the stream reaches the given offset.
+ */
+static void PadTo(std::ofstream& out, uint64_t offset) {
+    static const char zeros[kBankAlignment] = {};
+    uint64_t position = static_cast<uint64_t>(out.tellp());
+    while (position < offset) {
+        uint64_t count = std::min<uint64_t>(offset - position, kBankAlignment);
+        out.write(zeros, static_cast<std::streamsize>(count));
+        position += count;
+    }
+}
+
+/**
+ * @brief Collects and validates every WAV file below a directory.
+ *
+ * Invalid or unsupported files are reported and skipped.
+ *
+ * @param directory The directory to scan recursively.
+ * @param excluded The names of the sounds to leave out, e.g. streamed music.
+ * @param sounds Receives the parsed sounds, sorted by name.
+ */
+static void CollectSounds(const std::filesystem::path& directory, const std::set<std::string>& excluded,
+    std::vector<PackedSound>& sounds) {
+    for (const auto& item : std::filesystem::recursive_directory_iterator(directory)) {
+        if (!item.is_regular_file()) continue;
+
+        std::string extension = item.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (extension != ".wav") continue;
+
+        PackedSound sound;
+        std::filesystem::path relative = std::filesystem::relative(item.path(), directory);
+        sound.name = relative.replace_extension().generic_string();
+        if (excluded.count(sound.name)) continue;
+
+        if (!sound.file.Open(item.path().string()) ||
+            !ParseWav(sound.file.Data(), sound.file.Size(), &sound.info)) {
+            std::cout << "Skipping " << item.path().string() << " (not a supported WAV)" << std::endl;
+            continue;
+        }
+
+        WavInfo& info = sound.info;
+        ALenum format = SampleConvert::TargetFormat(info, false);
+        if (format != info.format) {
+            sound.converted.resize(SampleConvert::TargetSize(info.encoding, info.dataSize, format));
+            SampleConvert::Convert(info.encoding, info.samples, info.dataSize, format, sound.converted.data());
+            info.format = format;
+            info.encoding = kWavPcm16;
+            info.bitsPerSample = 16;
+            info.samples = sound.converted.data(); // Moving the sound keeps the vector's storage
+            info.dataSize = sound.converted.size();
+        }
+        sounds.push_back(std::move(sound));
+    }
+
+    std::sort(sounds.begin(), sounds.end(),
+        [](const PackedSound& a, const PackedSound& b) { return a.name < b.name; });
+}
+
+/**
+ * @brief Writes the bank file: header, hash index, entries, names and PCM blobs.
+ *
+ * @param sounds The sounds to pack.
+ * @param output The path of the bank to create.
+ * @return True on success.
+ */
+static bool WriteBank(const std::vector<PackedSound>& sounds, const std::string& output) {
+    // Keep the table at most half full so probe sequences stay short
+    uint32_t slotCount = 2;
+    while (slotCount < sounds.size() * 2) slotCount *= 2;
+
+    BankHeader header = {};
+    std::copy(kBankMagic, kBankMagic + 4, header.magic);
+    header.version = kBankVersion;
+    header.entryCount = static_cast<uint32_t>(sounds.size());
+    header.slotCount = slotCount;
+    header.slotsOffset = sizeof(BankHeader);
+    header.entriesOffset = header.slotsOffset + uint64_t(slotCount) * sizeof(uint32_t);
+    header.namesOffset = header.entriesOffset + uint64_t(sounds.size()) * sizeof(BankEntry);
+
+    std::string names;
+    std::vector<BankEntry> entries(sounds.size());
+    for (size_t i = 0; i < sounds.size(); i++) {
+        entries[i].nameHash = SoundBank::HashName(sounds[i].name);
+        entries[i].nameOffset = static_cast<uint32_t>(names.size());
+        entries[i].nameLength = static_cast<uint32_t>(sounds[i].name.size());
+        entries[i].format = sounds[i].info.format;
+        entries[i].sampleRate = sounds[i].info.sampleRate;
+        entries[i].dataSize = sounds[i].info.dataSize;
+        names += sounds[i].name;
+    }
+    header.namesSize = names.size();
+
+    // Lay the PCM blobs out after the names, each on an aligned boundary
+    uint64_t offset = header.namesOffset + header.namesSize;
+    for (auto& e : entries) {
+        offset = AlignUp(offset);
+        e.dataOffset = offset;
+        offset += e.dataSize;
+    }
+
+    // Build the open-addressing index
+    std::vector<uint32_t> slots(slotCount, 0);
+    for (uint32_t i = 0; i < entries.size(); i++) {
+        uint32_t slot = static_cast<uint32_t>(entries[i].nameHash) & (slotCount - 1);
+        while (slots[slot] != 0) slot = (slot + 1) & (slotCount - 1);
+        slots[slot] = i + 1;
+    }
+
+    std::ofstream out(output, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(slots.data()), static_cast<std::streamsize>(slots.size() * sizeof(uint32_t)));
+    out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(BankEntry)));
+    out.write(names.data(), static_cast<std::streamsize>(names.size()));
+    for (size_t i = 0; i < sounds.size(); i++) {
+        PadTo(out, entries[i].dataOffset);
+        out.write(reinterpret_cast<const char*>(sounds[i].info.samples), static_cast<std::streamsize>(entries[i].dataSize));
+    }
+
+    return static_cast<bool>(out);
+}
+
+/**
+ * @brief Entry point of the bank builder.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The assets directory, the output bank path and the names of the sounds to leave out.
+ * @return 0 on success, 1 on failure.
+ */
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cout << "Usage: BankBuilder <assets directory> <output bank> [excluded sound...]" << std::endl;
+        return 1;
+    }
+
+    std::filesystem::path directory(argv[1]);
+    if (!std::filesystem::is_directory(directory)) {
+        std::cout << "Not a directory: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::set<std::string> excluded(argv + 3, argv + argc);
+    std::vector<PackedSound> sounds;
+    CollectSounds(directory, excluded, sounds);
+
+    if (!WriteBank(sounds, argv[2])) {
+        std::cout << "Could not write " << argv[2] << std::endl;
+        return 1;
+    }
+
+    uint64_t bytes = 0;
+    for (const auto& s : sounds) bytes += s.info.dataSize;
+    std::cout << "Packed " << sounds.size() << " sounds (" << bytes / 1024 << " KB of PCM) into " << argv[2] << std::endl;
+    return 0;
+}
@@ -78,16 +78,24 @@ char buffer[32];
 // --- Sound Manager ---
 /** @brief Instance of the audio manager for handling sounds and music. */
 AudioManager audio;
-/** @brief ID for the daytime background music track. */
-int backgroundMusic = -1;
-/** @brief ID for the nighttime background music track. */
-int nightMusic = -1;
-/** @brief ID for the tavern music track. */
-int tabernMusic = -1;
+/** @brief Handle of the daytime background music track. */
+SoundHandle backgroundMusic;
+/** @brief Handle of the nighttime background music track. */
+SoundHandle nightMusic;
+/** @brief Handle of the tavern music track. */
+SoundHandle tabernMusic;
+/** @brief Mixer buses: all music, creature sounds and ambient sounds. */
+int musicBus, sfxBus, ambienceBus;
+/** @brief Flag indicating if the music bus is muted ('M' key). */
+bool musicMuted = false;
+/** @brief Flag indicating if sounds are placed around the player for headphones ('H' key). */
+bool headphones = false;
 /** @brief Flag indicating if the player is currently outside. */
 bool outside = true;
-/** @brief List of sound IDs for individual enemy movement/proximity sounds. */
-std::vector<int> enemyMusicIdList = {};
+/** @brief List of sound handles for individual enemy movement/proximity sounds. */
+std::vector<SoundHandle> enemyMusicIdList = {};
+/** @brief Spatial emitters of the enemy sounds, one per enemy in drawable order. */
+std::vector<EmitterHandle> enemyEmitterList = {};
 // --- *** ---
 
 /**
@@ -122,8 +130,8 @@ void UpdateEnemys() {
     // Starts from index 1 because index 0 is typically the background
     for (int i = 1; i < 5; i++) {
         drawableList[i].MoveTowards(player.posX, player.posY, board);
-        // IDs for spatial sound sources start from a specific offset (i+2)
-        audio.SetSourcePosition(i + 2, drawableList[i].posX, drawableList[i].posY);
+        // Enemy emitters are stored in drawable order, starting at drawable 1
+        audio.SetSourcePosition(enemyEmitterList[i - 1], drawableList[i].posX, drawableList[i].posY);
 
         if (drawableList[i].posX == player.posX && drawableList[i].posY == player.posY) {
             hasLost = true;
@@ -249,28 +257,52 @@ void CheckSpecialPlaces() {
  */
 void UpdateInput() {
     bool hasMoved = false;
+    int stepX = 0, stepY = 0;
     // Check for 'W' (Up) movement
     if (esat::IsKeyPressed('W') && CanIMoveThere(player.posX, player.posY - 1)) {
         player.posY--;
+        stepY = -1;
         hasMoved = true;
     }
     // Check for 'S' (Down) movement
     else if (esat::IsKeyPressed('S') && CanIMoveThere(player.posX, player.posY + 1)) {
         player.posY++;
+        stepY = 1;
         hasMoved = true;
     }
     // Check for 'A' (Left) movement
     else if (esat::IsKeyPressed('A') && CanIMoveThere(player.posX - 1, player.posY)) {
         player.posX--;
+        stepX = -1;
         hasMoved = true;
     }
     // Check for 'D' (Right) movement
     else if (esat::IsKeyPressed('D') && CanIMoveThere(player.posX + 1, player.posY)) {
         player.posX++;
+        stepX = 1;
         hasMoved = true;
     }
 
+    // 'M' mutes or unmutes all the music at once
+    if (esat::IsKeyDown('M')) {
+        musicMuted = !musicMuted;
+        audio.SetBusMuted(musicBus, musicMuted);
+    }
+
+    // 'H' switches to sounds placed around the player (HRTF when the device allows it) and back
+    if (esat::IsKeyDown('H')) {
+        headphones = !headphones;
+        audio.SetListenerMode(headphones ? AudioManager::kWorld3D : AudioManager::kPanned2D);
+        audio.SetHrtf(headphones);
+    }
+
+    // 'P' prints what the audio system costs (see AudioStats)
+    if (esat::IsKeyDown('P')) {
+        audio.GetStats().Dump(std::cout);
+    }
+
     if (hasMoved) {
+        audio.SetListenerFacing(static_cast<float>(stepX), static_cast<float>(stepY)); // The player faces where they walk
         CheckSpecialPlaces();
         stepAmmount--;
 
@@ -339,7 +371,8 @@ void InitTextConfig() {
 /**
  * @brief Initializes the audio manager and loads all necessary sound files.
  *
- * Loads background music tracks (day, night, tavern) and enemy/ambient sounds.
+ * Opens the streamed background music tracks (day, night, tavern) and loads enemy/ambient sounds,
+ * routing each group to its own mixer bus.
  * Registers 2D spatial sound sources for enemies and an ambient bird sound.
  * Starts playback of the initial background music.
  */
@@ -348,36 +381,74 @@ void InitBaseMusic() {
         printf("Error inicializando OpenAL\n");
     }
 
-    // Load background music tracks
-    backgroundMusic = audio.LoadWav("../assets/fondo.wav");
-    tabernMusic = audio.LoadWav("../assets/casa.wav");
-    nightMusic = audio.LoadWav("../assets/noche.wav");
+    // Fades and voice management run on their own thread, independent of the 8 fps loop
+    audio.StartAudioThread();
+
+    // Group the sounds so each group can be turned down, muted or paused with one call
+    musicBus = audio.CreateBus("music");
+    sfxBus = audio.CreateBus("sfx");
+    ambienceBus = audio.CreateBus("ambience");
+
+    // The birds go quiet while a creature is close enough to be heard
+    audio.AddDuckRule(ambienceBus, sfxBus, -8.0f, 0.2f, 1.5f);
+
+    // Open background music tracks (streamed, only a few buffers stay resident)
+    backgroundMusic = audio.OpenStream("../assets/fondo.wav");
+    tabernMusic = audio.OpenStream("../assets/casa.wav");
+    nightMusic = audio.OpenStream("../assets/noche.wav");
+    audio.SetBus(backgroundMusic, musicBus);
+    audio.SetBus(tabernMusic, musicBus);
+    audio.SetBus(nightMusic, musicBus);
 
     // Set volume for night music
     audio.SetVolume(nightMusic, 0.5f);
 
-    // Load, register, and store IDs for enemy spatial sounds
+    // Prefer the packed bank (one file open, no parsing); fall back to loose WAVs
+    bool hasBank = audio.LoadBank("../assets/sounds.bank");
+    auto loadSound = [&](const char* name, const char* path) {
+        SoundHandle sound = hasBank ? audio.GetSound(name) : SoundHandle();
+        return !sound.IsNull() ? sound : audio.LoadWavAsync(path);
+    };
+
+    // Load (in the background), register, and store handles for enemy spatial sounds
     for (int i = 0; i < 4; i++) {
-        int enemyMusicId = audio.LoadWav("../assets/dinoStepMono.wav");
-        audio.Register2DSound(
+        SoundHandle enemyMusicId = loadSound("dinoStepMono", "../assets/dinoStepMono.wav");
+        EmitterHandle emitter = audio.Register2DSound(
             enemyMusicId,
             enemyPos[i].first,
             enemyPos[i].second,
             10.f // Radius
         );
+        audio.SetBus(enemyMusicId, sfxBus);
         enemyMusicIdList.push_back(enemyMusicId);
+        enemyEmitterList.push_back(emitter);
     }
 
-    // Load, register, and play ambient bird sound
-    int bird = audio.LoadWav("../assets/bird.wav");
+    // Load, register, and play ambient bird sound (playback starts once it is loaded)
+    SoundHandle bird = loadSound("bird", "../assets/bird.wav");
     audio.Register2DSound(bird, 37, 22, 20.f);
+    audio.SetBus(bird, ambienceBus);
     audio.Play(bird, true);
-    audio.SetVolume(bird, 5.0f);
 
     // Start playing the initial background music (day)
     audio.Play(backgroundMusic, true);
 }
 
+/**
+ * @brief Gives the board's acoustics to the audio: walls and reverb zones.
+ *
+ * Both grids match the board, one cell per tile. Sounds travel around the
+ * walls, and the player's tile (the listener position) picks the reverb.
+ * The tavern is the walled block whose door is at tile (25, 29).
+ */
+void InitMapAudio() {
+    audio.SetCollisionGrid(board.cells.data(), board.width, board.height);
+    audio.SetPropagation(AudioManager::kPathDistance);
+    audio.SetReverbGrid(board.width, board.height);
+    int tavernZone = audio.AddReverbZone(EFX_REVERB_PRESET_WOODEN_MEDIUMROOM);
+    audio.SetReverbZoneRect(tavernZone, 12, 19, 16, 10);
+}
+
 /**
  * @brief The main entry point of the application.
  *
@@ -401,8 +472,7 @@ int esat::main(int argc, char** argv) {
 
     // Load the board collision map from a black and white image
     BoardFromImage(&board, "../assets/Mapa1_bw.png");
-
-    float dt = 0.125f; // Time step for audio updates
+    InitMapAudio();
 
     // Main game loop
     while (esat::WindowIsOpened() && !esat::IsSpecialKeyDown(esat::kSpecialKey_Escape)) {
@@ -411,8 +481,7 @@ int esat::main(int argc, char** argv) {
         esat::DrawBegin();
         esat::DrawClear(0, 0, 0);
 
-        // Update audio state and 2D listener position
-        audio.Update(dt);
+        // Send the 2D listener position to the audio thread
         audio.UpdateSpatial2D(player.posX, player.posY);
 
         // Process input if the game is not over
@@ -0,0 +1,83 @@
+/**
+ * @file mainSpatialBench.cpp
+ * @brief Microbenchmark of the 2D attenuation kernel at crowd-scene emitter counts.
+ *
+ * Usage: SpatialBench [iterations]
+ *
+ * Attenuates 10k and 100k emitters scattered around the listener with every
+ * level the CPU supports (see SpatialKernel) and prints the cost per emitter,
+ * after checking that all levels agree with the scalar one.
+ */
+
+#include <spatialKernel.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+/**
+ * @brief Fills the arrays with emitters around the origin, most of them in range.
+ */
+static void Scatter(EmitterArrays& emitters, int count) {
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> range(20.0f, 300.0f);
+    emitters.Clear();
+    for (int i = 0; i < count; i++) emitters.Push(i, position(random), position(random), range(random));
+}
+
+/**
+ * @brief Returns the nanoseconds per emitter of one level, best of a few runs.
+ */
+static double Measure(EmitterArrays& emitters, SpatialKernel::Level level, int iterations) {
+    double best = 1e30;
+    for (int run = 0; run < 5; run++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            // Moves the listener a little so no pass can be skipped
+            SpatialKernel::Attenuate(emitters, 0.001f * i, -0.001f * i, level);
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count() / (static_cast<double>(iterations) * emitters.Size()));
+    }
+    return best;
+}
+
+/**
+ * @brief Checks that a level gives the same gains and pans as the scalar one.
+ */
+static bool Agrees(EmitterArrays& emitters, SpatialKernel::Level level) {
+    SpatialKernel::Attenuate(emitters, 3.5f, -7.25f, SpatialKernel::kScalar);
+    AlignedVector<float> gain = emitters.gain, pan = emitters.pan;
+    SpatialKernel::Attenuate(emitters, 3.5f, -7.25f, level);
+    return std::memcmp(gain.data(), emitters.gain.data(), gain.size() * sizeof(float)) == 0 &&
+        std::memcmp(pan.data(), emitters.pan.data(), pan.size() * sizeof(float)) == 0;
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+    if (iterations <= 0) iterations = 200;
+
+    SpatialKernel::Level best = SpatialKernel::Detect();
+    std::printf("Best level: %s\n", SpatialKernel::Name(best));
+
+    const int counts[] = { 10000, 100000 };
+    EmitterArrays emitters;
+    bool ok = true;
+    for (int count : counts) {
+        Scatter(emitters, count);
+        double scalar = 0.0;
+        for (int level = SpatialKernel::kScalar; level <= best; level++) {
+            auto current = static_cast<SpatialKernel::Level>(level);
+            bool agrees = Agrees(emitters, current);
+            ok &= agrees;
+            double ns = Measure(emitters, current, iterations);
+            if (current == SpatialKernel::kScalar) scalar = ns;
+            std::printf("%7d emitters  %-6s  %6.3f ns/emitter  %6.1f us/pass  x%.1f%s\n", count,
+                SpatialKernel::Name(current), ns, ns * count / 1000.0, scalar / ns, agrees ? "" : "  MISMATCH");
+        }
+    }
+    return ok ? 0 : 1;
+}
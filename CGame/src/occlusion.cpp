@@ -0,0 +1,155 @@
+/**
+ * @file occlusion.cpp
+ * @brief Grid line-of-sight traces and the low-pass filter they drive.
+ */
+
+#include <occlusion.h>
+#include <alCheck.h>
+#include <cmath>
+#include <cstdlib>
+
+/** @brief Broadband gain of each wall between listener and emitter (-6 dB). */
+static const float kWallGain = 0.5f;
+/** @brief High-frequency gain of each wall, on top of kWallGain. */
+static const float kWallGainHF = 0.25f;
+/** @brief Walls past this many change nothing more. */
+static const int kMaxWalls = 4;
+
+/**
+ * @brief Creates an occlusion without grid; call Init once a context is current.
+ */
+Occlusion::Occlusion()
+    : genFilters_(nullptr),
+    deleteFilters_(nullptr),
+    filteri_(nullptr),
+    filterf_(nullptr),
+    filter_(0),
+    width_(0),
+    height_(0),
+    cellSize_(1.0f) {
+}
+
+/**
+ * @brief Loads the EFX filter functions and creates the low-pass template.
+ *
+ * @param device The open device.
+ * @return True if sources can be muffled.
+ */
+bool Occlusion::Init(ALCdevice* device) {
+    if (!alcIsExtensionPresent(device, ALC_EXT_EFX_NAME)) return false;
+
+    genFilters_ = reinterpret_cast<LPALGENFILTERS>(alGetProcAddress("alGenFilters"));
+    deleteFilters_ = reinterpret_cast<LPALDELETEFILTERS>(alGetProcAddress("alDeleteFilters"));
+    filteri_ = reinterpret_cast<LPALFILTERI>(alGetProcAddress("alFilteri"));
+    filterf_ = reinterpret_cast<LPALFILTERF>(alGetProcAddress("alFilterf"));
+    if (!genFilters_ || !deleteFilters_ || !filteri_ || !filterf_) return false;
+
+    alGetError();
+    AL_PROBE(genFilters_(1, &filter_));
+    AL_PROBE(filteri_(filter_, AL_FILTER_TYPE, AL_FILTER_LOWPASS));
+    if (alGetError() != AL_NO_ERROR) {
+        filter_ = 0;
+        return false;
+    }
+    AL_CALL(filterf_(filter_, AL_LOWPASS_GAIN, 1.0f)); // The broadband part goes through the source gain
+    return true;
+}
+
+/**
+ * @brief Deletes the filter template; sources keep their own copies.
+ */
+void Occlusion::Close() {
+    if (IsAvailable()) AL_CALL(deleteFilters_(1, &filter_));
+    filter_ = 0;
+}
+
+/**
+ * @brief Copies a collision grid.
+ *
+ * @param cells One value per cell, row by row; nonzero cells block sound.
+ * @param width The number of columns.
+ * @param height The number of rows.
+ * @param cellSize The size of a cell in world units (the units of the emitter positions).
+ */
+void Occlusion::SetGrid(const int* cells, int width, int height, float cellSize) {
+    width_ = cells ? width : 0;
+    height_ = cells ? height : 0;
+    cellSize_ = cellSize > 0.0f ? cellSize : 1.0f;
+    walls_.assign(static_cast<size_t>(width_) * height_, 0);
+    for (size_t i = 0; i < walls_.size(); i++) walls_[i] = cells[i] != 0;
+}
+
+/**
+ * @brief Returns the cell coordinate of a world coordinate.
+ */
+int Occlusion::CellOf(float position) const {
+    return static_cast<int>(std::floor(position / cellSize_));
+}
+
+/**
+ * @brief Counts the walls on the line between two cells.
+ *
+ * Bresenham's walk over the cells between the two ends, which are not
+ * counted themselves (an emitter standing in a wall cell is not behind it).
+ * Cells outside the grid are open.
+ *
+ * @return The number of wall cells crossed.
+ */
+int Occlusion::Trace(int x0, int y0, int x1, int y1) const {
+    int dx = std::abs(x1 - x0), dy = -std::abs(y1 - y0);
+    int stepX = x0 < x1 ? 1 : -1, stepY = y0 < y1 ? 1 : -1;
+    int error = dx + dy;
+    int walls = 0;
+
+    int x = x0, y = y0;
+    while (true) {
+        int doubled = 2 * error;
+        if (doubled >= dy) {
+            if (x == x1) break;
+            error += dy;
+            x += stepX;
+        }
+        if (doubled <= dx) {
+            if (y == y1) break;
+            error += dx;
+            y += stepY;
+        }
+        if (x == x1 && y == y1) break;
+        walls += IsWall(x, y);
+    }
+    return walls;
+}
+
+/**
+ * @brief Sets the direct-path low-pass of a source; 1 removes the filter.
+ */
+void Occlusion::ApplyLowpass(ALuint source, float gainHF) const {
+    if (!IsAvailable()) return;
+    if (gainHF >= 1.0f) {
+        AL_CALL(alSourcei(source, AL_DIRECT_FILTER, AL_FILTER_NULL));
+        return;
+    }
+    AL_CALL(filterf_(filter_, AL_LOWPASS_GAINHF, gainHF));
+    AL_CALL(alSourcei(source, AL_DIRECT_FILTER, static_cast<ALint>(filter_)));
+}
+
+/**
+ * @brief Broadband gain of a sound heard through a number of walls.
+ */
+float Occlusion::Gain(int walls) {
+    return std::pow(kWallGain, static_cast<float>(walls < kMaxWalls ? walls : kMaxWalls));
+}
+
+/**
+ * @brief High-frequency gain of a sound heard through a number of walls.
+ */
+float Occlusion::GainHF(int walls) {
+    return std::pow(kWallGainHF, static_cast<float>(walls < kMaxWalls ? walls : kMaxWalls));
+}
+
+/**
+ * @brief Returns true if a cell is inside the grid and blocks sound.
+ */
+bool Occlusion::IsWall(int x, int y) const {
+    return x >= 0 && y >= 0 && x < width_ && y < height_ && walls_[y * width_ + x] != 0;
+}
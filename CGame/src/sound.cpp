@@ -2,25 +2,51 @@
  * @file sound.cpp
  * @brief Implementation of the AudioManager class for OpenAL-based audio management.
  *
- * This file provides functionality for initializing OpenAL, loading WAV files,
- * playing, stopping, controlling volume, and handling 2D spatial audio.
+ * This file provides functionality for initializing OpenAL, loading or streaming
+ * WAV files, playing, stopping, controlling volume, and handling 2D spatial audio.
  */
 
 #include <sound.h>
-#include <fstream>
+#include <alCheck.h>
+#include <sampleConvert.h>
 #include <vector>
-#include <iostream>
-#include <cstring>
+#include <utility>
 #include <algorithm>
 #include <cmath> // For std::sqrt
+#include <chrono>
+#include <filesystem>
+
+/** @brief Number of commands the game thread can queue before it has to wait for the audio thread. */
+static const size_t kCommandCapacity = 4096;
+
+/** @brief Number of end-of-playback events kept for the game thread, and of pending source stop events. */
+static const size_t kEventCapacity = 1024;
+
+/** @brief Seconds before its end at which a sound gets its follower queued behind it (see QueueAfter). */
+static const float kFollowLead = 0.5f;
+
+/** @brief Side of the emitter index buckets, in collision cells (see SetCollisionGrid). */
+static const float kEmitterBucketCells = 8.0f;
+
+/** @brief Last fraction of an emitter's range over which kWorld3D fades it out, so leaving range is not a cut. */
+static const float kEdgeFade = 0.1f;
+
+/** @brief The manager whose audio thread is the calling thread, if any (see Post). */
+static thread_local const AudioManager* tlsAudioThreadOwner = nullptr;
 
  /**
   * @brief Default constructor for AudioManager.
   *
-  * Initializes the OpenAL device and context pointers to null.
+  * Initializes the OpenAL device, context and extension pointers to null.
   */
 AudioManager::AudioManager()
-    : device_(nullptr), context_(nullptr) {
+    : device_(nullptr), context_(nullptr), bufferDataStatic_(nullptr), floatFormats_(false), deferUpdates_(nullptr),
+    processUpdates_(nullptr), batchDepth_(0), eventControl_(nullptr), eventCallback_(nullptr), getInteger64_(nullptr),
+    playAtTime_(nullptr), getSourcei64_(nullptr), lastSeamError_(0), spatialTick_(0), propagation_(kStraightLine), listenerX_(0.0f), listenerY_(0.0f), listenerCellX_(0), listenerCellY_(0),
+    listenerMode_(kPanned2D), facingX_(0.0f), facingY_(-1.0f), listenerDirty_(false), resetDevice_(nullptr), renderSamples_(nullptr), renderType_(0), renderRate_(0),
+    renderPending_(0.0), renderedFrames_(0), random_(std::random_device{}()), streamReaderQuit_(false), commands_(kCommandCapacity),
+    audioThreaded_(false), audioThreadQuit_(false), stoppedSources_(kEventCapacity), stoppedOverflow_(false),
+    endedEvents_(kEventCapacity), reportEnds_(false), loadQuit_(false) {
 }
 
 /**
@@ -33,28 +59,48 @@ AudioManager::~AudioManager() {
 }
 
 /**
- * @brief Checks for and reports any OpenAL errors.
- *
- * Queries the current OpenAL error state and prints a descriptive message
- * to the console if an error is detected. This function is generally used
- * internally after OpenAL calls to ensure operation integrity.
+ * @brief Returns the size in bytes of one sample frame of an OpenAL buffer format.
  */
-void CheckErrors() {
-    ALenum err = alGetError();
-    if (err != AL_NO_ERROR) {
-        const char* errMsg = "";
-        switch (err) {
-        case AL_INVALID_NAME:        errMsg = "AL_INVALID_NAME"; break;
-        case AL_INVALID_ENUM:        errMsg = "AL_INVALID_ENUM"; break;
-        case AL_INVALID_VALUE:       errMsg = "AL_INVALID_VALUE"; break;
-        case AL_INVALID_OPERATION:   errMsg = "AL_INVALID_OPERATION"; break;
-        case AL_OUT_OF_MEMORY:       errMsg = "AL_OUT_OF_MEMORY"; break;
-        default:                     errMsg = "Unknown OpenAL error"; break;
-        }
-        std::cout << "OpenAL Error: " << errMsg << std::endl;
+static int FrameSize(ALenum format) {
+    switch (format) {
+    case AL_FORMAT_MONO8:          return 1;
+    case AL_FORMAT_MONO16:         return 2;
+    case AL_FORMAT_STEREO8:        return 2;
+    case AL_FORMAT_STEREO16:       return 4;
+    case AL_FORMAT_MONO_FLOAT32:   return 4;
+    case AL_FORMAT_STEREO_FLOAT32: return 8;
+    default:                       return 1;
     }
 }
 
+/** @brief Gain below which a channel is considered inaudible and gives its voice up. */
+static const float kAudibleGain = 0.001f;
+
+/**
+ * @brief Pauses a playing source, or resumes a source that was paused.
+ *
+ * A source that ended in the meantime is left stopped rather than restarted.
+ */
+static void ToggleBusPause(ALuint source, bool paused) {
+    ALint state = 0;
+    AL_CALL(alGetSourcei(source, AL_SOURCE_STATE, &state));
+    if (paused && state == AL_PLAYING) AL_CALL(alSourcePause(source));
+    else if (!paused && state == AL_PAUSED) AL_CALL(alSourcePlay(source));
+}
+
+/**
+ * @brief Orders two sounds for voice allocation: priority first, then gain.
+ *
+ * @return True if sound a should keep (or get) a voice rather than sound b.
+ */
+static bool Outranks(int priorityA, float gainA, int priorityB, float gainB) {
+    if (priorityA != priorityB) return priorityA > priorityB;
+    return gainA > gainB;
+}
+
+/** @brief Seed of the one-shot variation in loopback mode, so renders repeat exactly. */
+static const unsigned kLoopbackSeed = 1;
+
 /**
  * @brief Initializes the OpenAL device and context.
  *
@@ -62,13 +108,100 @@ void CheckErrors() {
  * and makes the context current on the calling thread. All resources are
  * cleaned up if any step fails.
  *
+ * The voice pool is created here: every loaded sound plays through one of
+ * these sources, so the mixer never runs more than maxVoices at once no matter
+ * how many sounds are loaded (see Play). If the driver runs out of sources
+ * earlier, the pool is simply smaller.
+ *
+ * @param maxVoices The number of pooled sources.
  * @return True if initialization is successful, false otherwise.
  */
-bool AudioManager::Init() {
+bool AudioManager::Init(int maxVoices) {
     device_ = alcOpenDevice(nullptr);
     if (!device_) return false;
+    return InitContext(nullptr, maxVoices);
+}
+
+/**
+ * @brief Initializes OpenAL on a loopback device instead of a sound card.
+ *
+ * Nothing is played: the mix is computed only when Render is called, for
+ * exactly the time given to it, so a session can be rendered faster than real
+ * time, on a machine without audio hardware, and the same calls always give
+ * the same samples. Everything else (fades, buses, spatial sounds, ...) works
+ * as with Init. The output is stereo at the given rate.
+ *
+ * To keep renders repeatable, streams are read by Render rather than by the
+ * reader thread, the audio thread does not start (see StartAudioThread), the
+ * one-shot variation is seeded with a constant, and ClockTime counts rendered
+ * samples. Background loads should be waited for (see WaitForLoads) before
+ * the sounds they feed are started.
+ *
+ * Needs ALC_SOFT_loopback; Render takes the place of Update.
+ *
+ * @param sampleRate The output rate in Hz.
+ * @param maxVoices The number of pooled sources.
+ * @return True if initialization is successful, false otherwise.
+ */
+bool AudioManager::InitLoopback(int sampleRate, int maxVoices) {
+    if (alcIsExtensionPresent(nullptr, "ALC_SOFT_loopback") != ALC_TRUE) return false;
+    auto openLoopback = reinterpret_cast<LPALCLOOPBACKOPENDEVICESOFT>(
+        alcGetProcAddress(nullptr, "alcLoopbackOpenDeviceSOFT"));
+    auto isFormatSupported = reinterpret_cast<LPALCISRENDERFORMATSUPPORTEDSOFT>(
+        alcGetProcAddress(nullptr, "alcIsRenderFormatSupportedSOFT"));
+    auto renderSamples = reinterpret_cast<LPALCRENDERSAMPLESSOFT>(
+        alcGetProcAddress(nullptr, "alcRenderSamplesSOFT"));
+    if (!openLoopback || !isFormatSupported || !renderSamples) return false;
+
+    device_ = openLoopback(nullptr);
+    if (!device_) return false;
 
-    context_ = alcCreateContext(device_, nullptr);
+    // Float keeps the mix unclipped; 16-bit is the fallback every loopback device takes
+    ALCenum type = ALC_FLOAT_SOFT;
+    if (!isFormatSupported(device_, sampleRate, ALC_STEREO_SOFT, type)) type = ALC_SHORT_SOFT;
+    if (!isFormatSupported(device_, sampleRate, ALC_STEREO_SOFT, type)) {
+        alcCloseDevice(device_);
+        device_ = nullptr;
+        return false;
+    }
+
+    const ALCint format[] = {
+        ALC_FORMAT_CHANNELS_SOFT, ALC_STEREO_SOFT, ALC_FORMAT_TYPE_SOFT, type, ALC_FREQUENCY, sampleRate, 0
+    };
+    if (!InitContext(format, maxVoices)) return false;
+
+    renderSamples_ = renderSamples;
+    renderType_ = type;
+    renderRate_ = sampleRate;
+    renderPending_ = 0.0;
+    renderedFrames_ = 0;
+    random_.seed(kLoopbackSeed);
+    return true;
+}
+
+/**
+ * @brief Creates the context on the open device_ and sets up everything that lives in it.
+ *
+ * Shared by Init and InitLoopback. On failure the device is closed too.
+ *
+ * @param formatAttributes Extra zero-terminated context attributes, or null.
+ * @param maxVoices The number of pooled sources.
+ * @return True if the context is current and ready.
+ */
+bool AudioManager::InitContext(const ALCint* formatAttributes, int maxVoices) {
+    std::vector<ALCint> attributes;
+    for (const ALCint* attribute = formatAttributes; attribute && *attribute; attribute += 2) {
+        attributes.push_back(attribute[0]);
+        attributes.push_back(attribute[1]);
+    }
+
+    // Every source gets the auxiliary sends the reverb zones blend through (see SetReverbGrid)
+    if (alcIsExtensionPresent(device_, ALC_EXT_EFX_NAME) == ALC_TRUE) {
+        attributes.insert(attributes.end(), { ALC_MAX_AUXILIARY_SENDS, ReverbZones::kSends });
+    }
+    attributes.push_back(0);
+
+    context_ = alcCreateContext(device_, attributes.size() > 1 ? attributes.data() : nullptr);
     if (!context_) {
         alcCloseDevice(device_);
         device_ = nullptr;
@@ -83,280 +216,3001 @@ bool AudioManager::Init() {
         return false;
     }
 
+    // Zero-copy buffers are optional; LoadWav falls back to alBufferData
+    if (alIsExtensionPresent("AL_EXT_STATIC_BUFFER")) {
+        bufferDataStatic_ = reinterpret_cast<PFNALBUFFERDATASTATICPROC>(alGetProcAddress("alBufferDataStatic"));
+    }
+
+    // Float buffers are optional too; without them deep WAVs are reduced to 16-bit
+    floatFormats_ = alIsExtensionPresent("AL_EXT_FLOAT32") == AL_TRUE;
+
+    // Batches property changes per tick; alcSuspendContext is the fallback (see BeginBatch)
+    if (alIsExtensionPresent("AL_SOFT_deferred_updates")) {
+        deferUpdates_ = reinterpret_cast<LPALDEFERUPDATESSOFT>(alGetProcAddress("alDeferUpdatesSOFT"));
+        processUpdates_ = reinterpret_cast<LPALPROCESSUPDATESSOFT>(alGetProcAddress("alProcessUpdatesSOFT"));
+        if (!deferUpdates_ || !processUpdates_) deferUpdates_ = nullptr;
+    }
+
+    reverb_.Init(device_);
+    occlusion_.Init(device_);
+
+    alGetError(); // Clear any stale error before probing the source limit
+    for (int i = 0; i < maxVoices; i++) {
+        Voice voice;
+        AL_PROBE(alGenSources(1, &voice.source.id));
+        if (alGetError() != AL_NO_ERROR) break;
+        reverb_.Attach(voice.source.id);
+        sourceVoices_[voice.source.id] = static_cast<int>(voices_.size());
+        voices_.push_back(voice);
+    }
+
+    // Finished voices are pushed by OpenAL instead of polled every tick (see UpdateVoices)
+    if (alIsExtensionPresent("AL_SOFT_events")) {
+        eventControl_ = reinterpret_cast<LPALEVENTCONTROLSOFT>(alGetProcAddress("alEventControlSOFT"));
+        eventCallback_ = reinterpret_cast<LPALEVENTCALLBACKSOFT>(alGetProcAddress("alEventCallbackSOFT"));
+        if (eventControl_ && eventCallback_) {
+            const ALenum types[] = { AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT };
+            AL_CALL(eventCallback_(&AudioManager::OnSourceEvent, this));
+            AL_CALL(eventControl_(1, types, AL_TRUE));
+        }
+        else {
+            eventControl_ = nullptr;
+            eventCallback_ = nullptr;
+        }
+    }
+
+    // HRTF is switched by resetting the device (see SetHrtf)
+    if (alcIsExtensionPresent(device_, "ALC_SOFT_HRTF")) {
+        resetDevice_ = reinterpret_cast<LPALCRESETDEVICESOFT>(alcGetProcAddress(device_, "alcResetDeviceSOFT"));
+    }
+
+    // Sample-exact scheduling needs the device clock (see ClockTime and PlayAt)
+    if (alcIsExtensionPresent(device_, "ALC_SOFT_device_clock")) {
+        getInteger64_ = reinterpret_cast<LPALCGETINTEGER64VSOFT>(alcGetProcAddress(device_, "alcGetInteger64vSOFT"));
+        if (getInteger64_ && alIsExtensionPresent("AL_SOFT_source_start_delay")) {
+            playAtTime_ = reinterpret_cast<LPALSOURCEPLAYATTIMESOFT>(alGetProcAddress("alSourcePlayAtTimeSOFT"));
+        }
+        // Reads a voice's offset and the clock of the same mix, to predict its end exactly (see UpdateFollower)
+        if (playAtTime_ && alIsExtensionPresent("AL_SOFT_source_latency")) {
+            getSourcei64_ = reinterpret_cast<LPALGETSOURCEI64VSOFT>(alGetProcAddress("alGetSourcei64vSOFT"));
+        }
+    }
+
     return true;
 }
 
 /**
- * @brief Loads audio data from a WAV file into an OpenAL buffer and creates a source.
+ * @brief Maps and parses a WAV file, readying its samples for the upload.
+ *
+ * The file is memory-mapped and parsed in place (see ParseWav), so the payload
+ * is never copied into a temporary heap buffer, and its pages are pulled in
+ * from disk here rather than during the upload. Files OpenAL cannot take as
+ * they are (24 or 32-bit integers, or floats without AL_EXT_FLOAT32) are
+ * converted instead (see SampleConvert) and the file is unmapped.
+ *
+ * Touches neither OpenAL nor the mixer state, so it runs on the loader
+ * threads and, for LoadWav, on the calling thread without stateMutex_.
+ *
+ * @param result Holds the cache key (the normalized path); receives the file and its samples.
+ */
+void AudioManager::ReadWav(LoadResult& result) const {
+    result.ok = result.file.Open(result.key) &&
+        ParseWav(result.file.Data(), result.file.Size(), &result.info);
+    if (!result.ok) return;
+
+    const WavInfo& info = result.info;
+    result.format = SampleConvert::TargetFormat(info, floatFormats_);
+    if (result.format == info.format) {
+        result.file.Prefault();
+    }
+    else {
+        result.converted.resize(SampleConvert::TargetSize(info.encoding, info.dataSize, result.format));
+        SampleConvert::Convert(info.encoding, info.samples, info.dataSize, result.format, result.converted.data());
+        result.file.Close();
+    }
+}
+
+/**
+ * @brief Creates the OpenAL buffer of a cache entry from mapped or converted samples.
+ *
+ * The buffer is filled straight from the samples. With AL_EXT_STATIC_BUFFER
+ * a buffer made from mapped samples keeps pointing at them, so the caller
+ * must keep them mapped for the buffer's lifetime (a WAV entry takes its file
+ * over; banks stay mapped until Close). Converted samples are always copied.
+ *
+ * @param entry The cache entry receiving the buffer.
+ * @param samples The PCM payload.
+ * @param size The size of the payload in bytes.
+ * @param format The OpenAL buffer format.
+ * @param sampleRate The sample rate in Hz.
+ * @param mapped True if the samples stay mapped for the buffer's lifetime.
+ */
+void AudioManager::UploadBuffer(CachedBuffer& entry, const unsigned char* samples, size_t size, ALenum format, int sampleRate,
+    bool mapped) {
+    AL_CALL(alGenBuffers(1, &entry.buffer));
+    if (bufferDataStatic_ && mapped) {
+        AL_CALL(bufferDataStatic_(static_cast<ALint>(entry.buffer), format, const_cast<unsigned char*>(samples),
+            static_cast<ALsizei>(size), sampleRate));
+    }
+    else {
+        AL_CALL(alBufferData(entry.buffer, format, samples, static_cast<ALsizei>(size), sampleRate));
+    }
+
+    // Kept so virtual channels can follow their position without asking OpenAL
+    entry.duration = sampleRate > 0 ? static_cast<float>(size / FrameSize(format)) / sampleRate : 0.0f;
+    entry.format = format;
+    entry.sampleRate = sampleRate;
+    entry.bytes = size;
+}
+
+/**
+ * @brief Drops one reference to a cached buffer, deleting it with the last one.
+ *
+ * Every voice using the buffer must already be released.
+ *
+ * @param key The normalized path the buffer was acquired with.
+ */
+void AudioManager::ReleaseBuffer(const std::string& key) {
+    auto it = bufferCache_.find(key);
+    if (it == bufferCache_.end()) return;
+    if (--it->second.refCount > 0) return;
+
+    AL_CALL(alDeleteBuffers(1, &it->second.buffer));
+    bufferCache_.erase(it); // Unmaps the file of a static buffer
+}
+
+/**
+ * @brief Loads a WAV file and creates a sound that plays it.
  *
- * This function parses the RIFF/WAVE file structure to extract format information
- * (channels, bits per sample, sample rate) and raw audio data. It then creates
- * an OpenAL buffer, uploads the data, creates an OpenAL source, and links them.
+ * Loading the same file again only creates a new sound: buffers are cached
+ * by normalized path and reference counted, so the PCM is read once and
+ * shared. No OpenAL source is created; the sound borrows a voice from the
+ * pool when played.
+ *
+ * The file is read on the calling thread (see ReadWav) without holding the
+ * lock the audio thread ticks under. While the audio thread runs, the OpenAL
+ * upload is left to its next tick, as with LoadWavAsync: the handle is usable
+ * right away and IsLoaded turns true once the buffer is attached.
  *
  * @param filename The path to the WAV file.
- * @return The index of the newly created source in the internal vector, or -1 on failure.
- */
-int AudioManager::LoadWav(const std::string& filename) {
-    ALuint buffer;
-    alGenBuffers(1, &buffer);
-
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) return -1;
-
-    // Check RIFF and WAVE header
-    char riff[4]; file.read(riff, 4);
-    file.ignore(4); // Chunk size
-    char wave[4]; file.read(wave, 4);
-
-    short audioFormat = 0, numChannels = 0, bitsPerSample = 0;
-    int sampleRate = 0;
-
-    bool fmtFound = false;
-    bool dataFound = false;
-    ALenum format = 0;
-    std::vector<char> data;
-
-    // Iterate through chunks to find "fmt " and "data"
-    while (!file.eof() && (!fmtFound || !dataFound)) {
-        char chunkId[4];
-        int chunkSize = 0;
-        file.read(chunkId, 4);
-        if (file.eof()) break;
-        file.read(reinterpret_cast<char*>(&chunkSize), 4);
-
-        if (std::strncmp(chunkId, "fmt ", 4) == 0) {
-            fmtFound = true;
-            file.read(reinterpret_cast<char*>(&audioFormat), 2);
-            file.read(reinterpret_cast<char*>(&numChannels), 2);
-            file.read(reinterpret_cast<char*>(&sampleRate), 4);
-            file.ignore(6); // ByteRate and BlockAlign
-            file.read(reinterpret_cast<char*>(&bitsPerSample), 2);
-            if (chunkSize > 16) file.ignore(chunkSize - 16); // Skip extra format info
-        }
-        else if (std::strncmp(chunkId, "data", 4) == 0) {
-            dataFound = true;
-            data.resize(chunkSize);
-            file.read(data.data(), chunkSize);
-        }
-        else {
-            file.ignore(chunkSize); // Skip unknown chunk
+ * @return The handle of the newly created sound, or a null handle on failure.
+ */
+SoundHandle AudioManager::LoadWav(const std::string& filename) {
+    LoadResult result;
+    result.key = std::filesystem::path(filename).lexically_normal().generic_string();
+    AUDIO_STAT(result.requested = std::chrono::steady_clock::now());
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        auto it = bufferCache_.find(result.key);
+
+        // Without the audio thread, a file loading in the background is finished here
+        while (!audioThreaded_ && it != bufferCache_.end() && it->second.buffer == 0) {
+            WaitForLoadResult();
+            ProcessLoads();
+            it = bufferCache_.find(result.key);
         }
+        if (it != bufferCache_.end()) return ShareBuffer(result.key);
     }
 
-    if (!fmtFound || !dataFound) return -1;
+    ReadWav(result);
+    if (!result.ok) return SoundHandle();
+    return PublishLoad(std::move(result));
+}
 
-    // Determine the OpenAL format
-    if (numChannels == 1 && bitsPerSample == 8) format = AL_FORMAT_MONO8;
-    else if (numChannels == 1 && bitsPerSample == 16) format = AL_FORMAT_MONO16;
-    else if (numChannels == 2 && bitsPerSample == 8) format = AL_FORMAT_STEREO8;
-    else if (numChannels == 2 && bitsPerSample == 16) format = AL_FORMAT_STEREO16;
-    else return -1; // Unsupported format
+/**
+ * @brief Creates a sound sharing a cached buffer, which may still be loading.
+ *
+ * A sound created while the load is in flight is attached to the buffer by
+ * ProcessLoads.
+ *
+ * @param key The key of an existing cache entry; a reference to it is taken.
+ * @return The handle of the newly created sound.
+ */
+SoundHandle AudioManager::ShareBuffer(const std::string& key) {
+    CachedBuffer& entry = bufferCache_[key];
+    entry.refCount++;
+    if (entry.buffer != 0) return CreateSource(entry, key);
 
-    // Buffer the audio data
-    alBufferData(buffer, format, data.data(), static_cast<ALsizei>(data.size()), sampleRate);
-    CheckErrors();
+    int index = CreateChannel(key);
+    channels_[index].loading = true;
+    return channels_.HandleAt(index);
+}
 
-    // Create a source and attach the buffer
-    ALuint source;
-    alGenSources(1, &source);
-    alSourcei(source, AL_BUFFER, buffer);
-    alSourcef(source, AL_GAIN, 1.0f); // Default volume
+/**
+ * @brief Creates the sound of samples read on the calling thread, and queues their upload.
+ *
+ * This is the only part of LoadWav and GetSound that holds stateMutex_. The
+ * upload goes through ProcessLoads like a background load: on the audio
+ * thread's next tick while it runs, right away otherwise. If a load of the
+ * same key finished meanwhile, its buffer is shared and this one dropped.
+ *
+ * @param result A successful read; its cache key names the buffer.
+ * @return The handle of the newly created sound.
+ */
+SoundHandle AudioManager::PublishLoad(LoadResult&& result) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    std::string key = result.key;
+    auto it = bufferCache_.find(key);
+    if (it == bufferCache_.end()) {
+        CachedBuffer entry;
+        AUDIO_STAT(entry.requested = result.requested);
+        it = bufferCache_.emplace(key, std::move(entry)).first;
+    }
+    if (it->second.buffer == 0) {
+        std::lock_guard<std::mutex> lock(loadMutex_);
+        loadResults_.push_back(std::move(result));
+    }
 
-    // Store the buffer and source handles
-    buffers_.push_back(buffer);
-    sources_.push_back(source);
+    SoundHandle sound = ShareBuffer(key);
+    if (!audioThreaded_) ProcessLoads(); // The calling thread is the one that ticks
+    return sound;
+}
 
-    return static_cast<int>(sources_.size() - 1);
+/**
+ * @brief Creates an empty channel with default volume.
+ *
+ * @param key The cache key of its buffer, released again by Unload (empty for streams).
+ * @return The slot index of the new channel.
+ */
+int AudioManager::CreateChannel(const std::string& key) {
+    Channel channel;
+    channel.soundKey = key;
+    return static_cast<int>(channels_.Insert(std::move(channel)).index);
 }
 
 /**
- * @brief Starts playback for the audio source at the specified index.
+ * @brief Creates a channel playing a cached buffer.
  *
- * @param index The index of the audio source to play (returned by LoadWav).
- * @param loop If true, the sound will loop continuously.
+ * @param entry The cache entry to play (its reference already taken).
+ * @param key The cache key of the buffer, released again by Unload.
+ * @return The handle of the newly created sound.
  */
-void AudioManager::Play(int index, bool loop) {
-    if (index < 0 || index >= static_cast<int>(sources_.size())) return;
-    alSourcei(sources_[index], AL_LOOPING, loop ? AL_TRUE : AL_FALSE);
-    alSourcePlay(sources_[index]);
+SoundHandle AudioManager::CreateSource(const CachedBuffer& entry, const std::string& key) {
+    int index = CreateChannel(key);
+    channels_[index].buffer = entry.buffer;
+    channels_[index].duration = entry.duration;
+    return channels_.HandleAt(index);
 }
 
 /**
- * @brief Stops playback for the audio source at the specified index.
+ * @brief Opens a packed sound bank built by BankBuilder.
+ *
+ * The whole bank is mapped once and its index validated; nothing is parsed
+ * or uploaded until GetSound asks for a sound. Several banks can be loaded.
  *
- * @param index The index of the audio source to stop.
+ * @param filename The path to the bank file.
+ * @return True if the bank was opened, false otherwise.
  */
-void AudioManager::Stop(int index) {
-    if (index < 0 || index >= static_cast<int>(sources_.size())) return;
-    alSourceStop(sources_[index]);
+bool AudioManager::LoadBank(const std::string& filename) {
+    std::unique_ptr<SoundBank> bank(new SoundBank());
+    if (!bank->Open(filename)) return false;
+
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    banks_.push_back(std::move(bank));
+    return true;
 }
 
 /**
- * @brief Updates the state of ongoing effects, primarily crossfading.
+ * @brief Creates a sound stored in a loaded bank.
  *
- * This method must be called regularly within the main game loop to progress
- * timed audio effects like crossfades.
+ * The PCM is uploaded from the bank mapping the first time a name is asked
+ * for and shared through the buffer cache afterwards, exactly like LoadWav:
+ * its pages are read from disk on the calling thread, and the upload is left
+ * to the next tick while the audio thread runs.
  *
- * @param deltaTime The time elapsed since the last update, typically in seconds.
+ * @param name The sound name: its path inside the packed directory, without extension.
+ * @return The handle of the newly created sound, or a null handle if no bank has the sound.
  */
-void AudioManager::Update(float deltaTime) {
-    if (fade_.active) {
-        fade_.elapsed += deltaTime;
-        float t = fade_.elapsed / fade_.duration; // Normalized time [0, 1]
+SoundHandle AudioManager::GetSound(const std::string& name) {
+    LoadResult result;
+    result.key = "bank:" + name;
+    AUDIO_STAT(result.requested = std::chrono::steady_clock::now());
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        if (bufferCache_.count(result.key)) return ShareBuffer(result.key);
+    }
 
-        if (t >= 1.0f) {
-            t = 1.0f;
-            fade_.active = false;
-            // Ensure the 'from' source is stopped once fade is complete
-            alSourceStop(sources_[fade_.from]);
+    // Only the calling thread opens banks, so they can be searched without the lock
+    BankSound sound;
+    bool found = false;
+    for (const auto& bank : banks_) {
+        if (bank->Find(name, &sound)) {
+            found = true;
+            break;
         }
-
-        // Apply fading gains (linear interpolation)
-        float gainFrom = 1.0f - t;
-        float gainTo = t;
-        alSourcef(sources_[fade_.from], AL_GAIN, gainFrom);
-        alSourcef(sources_[fade_.to], AL_GAIN, gainTo);
     }
+    if (!found) return SoundHandle();
+
+    // The bank stays mapped until Close, so even a static buffer can point into it
+    MappedFile::Prefault(sound.samples, sound.dataSize);
+    result.info.samples = sound.samples;
+    result.info.dataSize = sound.dataSize;
+    result.info.format = sound.format;
+    result.info.sampleRate = sound.sampleRate;
+    result.format = sound.format;
+    result.ok = true;
+    return PublishLoad(std::move(result));
 }
 
 /**
- * @brief Initiates a crossfade transition between two audio sources.
+ * @brief Starts loading a WAV file in the background and creates its sound now.
  *
- * Starts the 'to' sound and gradually decreases the volume of the 'from' sound
- * while increasing the volume of the 'to' sound over the specified duration.
+ * Mapping, reading and parsing the file happen on a pool of worker threads;
+ * the OpenAL upload is finished by Update on the thread that owns the context.
+ * The returned handle is usable right away: Play, SetVolume, Register2DSound,
+ * etc. are accepted while the load is in flight, and a requested Play starts
+ * as soon as the buffer is attached. Files already cached or loading are
+ * shared exactly like with LoadWav.
  *
- * @param fromIndex The index of the source to fade out.
- * @param toIndex The index of the source to fade in.
- * @param duration The length of the transition in seconds.
+ * If the file turns out to be missing or invalid, the sound is unloaded
+ * and IsLoaded/WaitLoaded report false.
+ *
+ * @param filename The path to the WAV file.
+ * @return The handle of the newly created sound.
  */
-void AudioManager::Crossfade(int fromIndex, int toIndex, float duration) {
-    if (fromIndex < 0 || fromIndex >= static_cast<int>(sources_.size())) return;
-    if (toIndex < 0 || toIndex >= static_cast<int>(sources_.size())) return;
+SoundHandle AudioManager::LoadWavAsync(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    std::string key = std::filesystem::path(filename).lexically_normal().generic_string();
+
+    if (bufferCache_.count(key)) return ShareBuffer(key);
+
+    // First request for this file: reserve the cache entry and queue the job
+    CachedBuffer entry;
+    AUDIO_STAT(entry.requested = std::chrono::steady_clock::now());
+    bufferCache_.emplace(key, std::move(entry));
+    SoundHandle sound = ShareBuffer(key);
 
-    // Configure and activate the fade state
-    fade_.from = fromIndex;
-    fade_.to = toIndex;
-    fade_.duration = duration;
-    fade_.elapsed = 0.0f;
-    fade_.active = true;
+    if (loadWorkers_.empty()) {
+        loadQuit_ = false;
+        unsigned workers = std::clamp(std::thread::hardware_concurrency(), 2u, 5u) - 1;
+        for (unsigned i = 0; i < workers; i++) loadWorkers_.emplace_back(&AudioManager::LoadWorkerLoop, this);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(loadMutex_);
+        loadQueue_.push_back(key);
+    }
+    loadWake_.notify_one();
 
-    // Start the destination sound immediately
-    alSourcePlay(sources_[toIndex]);
+    return sound;
 }
 
 /**
- * @brief Releases all OpenAL resources and closes the device and context.
+ * @brief Body of each loader worker thread.
  *
- * Deletes all sources and buffers, destroys the context, and closes the device.
- * This should be called before application exit.
+ * Reads queued files (see ReadWav) and hands the results back for
+ * ProcessLoads to upload.
  */
-void AudioManager::Close() {
-    // Delete sources and buffers
-    for (auto src : sources_) alDeleteSources(1, &src);
-    for (auto buf : buffers_) alDeleteBuffers(1, &buf);
-    sources_.clear();
-    buffers_.clear();
+void AudioManager::LoadWorkerLoop() {
+    for (;;) {
+        LoadResult result;
+        {
+            std::unique_lock<std::mutex> lock(loadMutex_);
+            loadWake_.wait(lock, [this] { return loadQuit_ || !loadQueue_.empty(); });
+            if (loadQuit_) return;
+            result.key = loadQueue_.front();
+            loadQueue_.pop_front();
+        }
 
-    // Destroy context and close device
-    if (context_) {
-        alcMakeContextCurrent(nullptr);
-        alcDestroyContext(context_);
-        context_ = nullptr;
+        ReadWav(result);
+
+        {
+            std::lock_guard<std::mutex> lock(loadMutex_);
+            loadResults_.push_back(std::move(result));
+        }
+        loadDone_.notify_all();
     }
-    if (device_) {
-        alcCloseDevice(device_);
-        device_ = nullptr;
+}
+
+/**
+ * @brief Blocks until at least one background load has a result waiting.
+ */
+void AudioManager::WaitForLoadResult() {
+    std::unique_lock<std::mutex> lock(loadMutex_);
+    loadDone_.wait(lock, [this] { return !loadResults_.empty(); });
+}
+
+/**
+ * @brief Uploads finished loads and attaches them to their sounds.
+ *
+ * Deferred Play requests are honoured here. Sounds whose file failed to
+ * load are unloaded. Streams opened since the last call get their source.
+ *
+ * Only the thread that ticks calls this: the audio thread while it runs
+ * (see AudioThreadLoop), otherwise Update and the loading and waiting
+ * functions. Failed loads are reported as ended playbacks (see ReportEnded)
+ * and by GetLoadStatus.
+ */
+void AudioManager::ProcessLoads() {
+    std::vector<LoadResult> done;
+    {
+        std::lock_guard<std::mutex> lock(loadMutex_);
+        done.swap(loadResults_);
+    }
+    bool attached = !done.empty() || !pendingStreams_.empty();
+    AttachStreams();
+
+    for (auto& result : done) {
+        auto it = bufferCache_.find(result.key);
+        // Skip loads whose sources were all unloaded, or that a duplicate job already finished
+        if (it == bufferCache_.end() || it->second.buffer != 0) continue;
+
+        if (result.ok) {
+            const WavInfo& info = result.info;
+            if (result.format == info.format) {
+                UploadBuffer(it->second, info.samples, info.dataSize, info.format, info.sampleRate, true);
+                if (bufferDataStatic_) it->second.mapping = std::move(result.file);
+            }
+            else {
+                UploadBuffer(it->second, result.converted.data(), result.converted.size(), result.format, info.sampleRate, false);
+            }
+            AUDIO_STAT(stats_.AddLoad(it->second.requested));
+        }
+        else {
+            bufferCache_.erase(it);
+        }
+
+        for (int index = 0; index < channels_.SlotCount(); index++) {
+            if (!channels_.IsLive(index)) continue;
+            Channel& channel = channels_[index];
+            if (!channel.loading || channel.soundKey != result.key) continue;
+
+            if (!result.ok) {
+                if (channel.playing) ReportEnded(index, VoiceHandle()); // A pending Play ends here
+                channel.soundKey.clear(); // The cache entry is already gone
+                UnloadChannel(index);
+                continue;
+            }
+
+            channel.loading = false;
+            channel.buffer = it->second.buffer;
+            channel.duration = it->second.duration;
+            if (channel.playing && HeardGain(channel) > kAudibleGain) AssignVoice(index);
+        }
     }
+
+    if (attached) loadsAttached_.notify_all(); // Wakes WaitLoaded and WaitForLoads
 }
 
 /**
- * @brief Sets the volume (gain) for a specific audio source.
+ * @brief Polls whether an asynchronously loaded sound has its buffer.
  *
- * The gain value is linear, where 1.0 is default volume.
+ * @param sound The handle returned by LoadWavAsync (or any other sound handle).
+ * @return True once the sound is loaded, false while loading, if it failed or if the handle is stale.
+ */
+bool AudioManager::IsLoaded(SoundHandle sound) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    int index = SlotOf(sound);
+    return index >= 0 && !channels_[index].loading;
+}
+
+/**
+ * @brief Tells a sound still loading from one whose load failed.
  *
- * @param index The index of the audio source.
- * @param gain The desired volume level (e.g., 0.0 for mute, 1.0 for full volume).
+ * @param sound The handle returned by LoadWavAsync (or any other sound handle).
+ * @return kLoading until the background load is uploaded, then kLoaded, or
+ *         kLoadFailed once the failed sound is unloaded (as for any stale handle).
  */
-void AudioManager::SetVolume(int index, float gain) {
-    if (index < 0 || index >= sources_.size()) return;
-    alSourcef(sources_[index], AL_GAIN, gain);
+AudioManager::LoadStatus AudioManager::GetLoadStatus(SoundHandle sound) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    int index = SlotOf(sound);
+    if (index < 0) return kLoadFailed;
+    return channels_[index].loading ? kLoading : kLoaded;
 }
 
 /**
- * @brief Registers an existing audio source as a 2D spatial sound.
+ * @brief Blocks until an asynchronously loaded sound has its buffer.
  *
- * This stores the initial position and maximum audible distance for the source,
- * allowing its volume and panning to be calculated based on the listener's position.
+ * While the audio thread runs, this waits for its ticks to do the upload,
+ * without holding them up. Otherwise it performs the upload itself, so it
+ * must be called from the thread that owns the OpenAL context.
  *
- * @param index The index of the audio source (returned by LoadWav).
- * @param x The initial X-coordinate of the sound source in world units.
- * @param y The initial Y-coordinate of the sound source in world units.
- * @param maxDistance The distance at which the sound is completely attenuated.
+ * @param sound The handle returned by LoadWavAsync (or LoadWav, GetSound, OpenStream).
+ * @return True if the sound loaded, false if it failed or the handle is stale.
  */
-void AudioManager::Register2DSound(int index, float x, float y, float maxDistance) {
-    spatialSources_.push_back({ index, x, y, maxDistance });
+bool AudioManager::WaitLoaded(SoundHandle sound) {
+    std::unique_lock<std::mutex> lock(stateMutex_);
+    // A failed load removes the sound, which turns the handle stale
+    auto loading = [this, sound] { return SlotOf(sound) >= 0 && channels_[SlotOf(sound)].loading; };
+    if (audioThreaded_) {
+        loadsAttached_.wait(lock, [&loading] { return !loading(); });
+    }
+    else {
+        while (loading()) {
+            WaitForLoadResult();
+            ProcessLoads();
+        }
+    }
+    return SlotOf(sound) >= 0;
 }
 
 /**
- * @brief Updates the world position of a registered 2D spatial sound source.
+ * @brief Blocks until every queued load is finished and uploaded.
  *
- * @param index The index of the spatial sound source to update.
- * @param x The new X-coordinate.
- * @param y The new Y-coordinate.
+ * Like WaitLoaded, leaves the uploads to the audio thread while it runs.
  */
-void AudioManager::SetSourcePosition(int index, float x, float y) {
-    for (auto& s : spatialSources_) {
-        if (s.sourceIndex == index) {
-            s.x = x;
-            s.y = y;
-            return;
+void AudioManager::WaitForLoads() {
+    std::unique_lock<std::mutex> lock(stateMutex_);
+    auto anyLoading = [this] {
+        for (int i = 0; i < channels_.SlotCount(); i++) {
+            if (channels_.IsLive(i) && channels_[i].loading) return true;
+        }
+        return false;
+    };
+    if (audioThreaded_) {
+        loadsAttached_.wait(lock, [&anyLoading] { return !anyLoading(); });
+    }
+    else {
+        while (anyLoading()) {
+            WaitForLoadResult();
+            ProcessLoads();
         }
     }
 }
 
 /**
- * @brief Updates the gain and panning for all registered 2D spatial sounds.
+ * @brief Stops a sound, gives its voice back and releases its buffer.
  *
- * Calculates distance-based attenuation (volume) and left/right panning
- * (position) relative to the listener's position and orientation.
+ * The shared buffer is only deleted once no other sound uses it. The handle
+ * (and every emitter registered for the sound) goes stale; calls made with it
+ * afterwards are ignored, even once its slot is reused by a new sound.
  *
- * **Note on Listener Orientation:** In this 2D system, the listener is assumed
- * to be facing in the negative X direction (fx = -1.0f) with 'right' being in the
- * positive X direction (rightX = 1.0f), which simplifies the calculation of panning
- * based on the sound's relative X-position to the listener.
+ * @param sound The handle of the sound to unload.
+ */
+void AudioManager::Unload(SoundHandle sound) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    int index = SlotOf(sound);
+    if (index >= 0) UnloadChannel(index);
+}
+
+/**
+ * @brief Unloads the sound in a slot (see Unload).
  *
- * @param listenerX The listener's X-coordinate.
- * @param listenerY The listener's Y-coordinate.
+ * @param index A live channel slot.
  */
-void AudioManager::UpdateSpatial2D(float listenerX, float listenerY) {
-    // Listener Orientation (Fixed for 2D top-down view)
-    float fx = -1.0f; // Forward direction (e.g., facing left)
-    float fy = 0.0f;
+void AudioManager::UnloadChannel(int index) {
+    Channel& channel = channels_[index];
 
-    float rightX = 1.0f; // Right direction (e.g., facing right)
-    float rightY = 0.0f;
+    // Our buffer must leave the queue of the sound we follow before it can be deleted
+    if (channel.follows >= 0) Unlink(channel.follows);
+
+    fades_.Cancel(index);
+    for (int i = 0; i < spatialSources_.SlotCount(); i++) {
+        if (spatialSources_.IsLive(i) && spatialSources_[i].channel == index) RemoveEmitter(i);
+    }
+
+    if (channel.stream >= 0) {
+        StreamSlot& slot = streams_[channel.stream];
+        slot.stream->Stop(slot.source.id);
+        slot.stream->Close();
+        AL_CALL(alDeleteSources(1, &slot.source.id));
+        std::lock_guard<std::mutex> lock(streamMutex_);
+        slot.stream.reset();
+    }
 
-    for (auto& s : spatialSources_) {
+    if (channel.voice >= 0) ReleaseVoice(index, false);
+    Unlink(index);
+    for (int v = 0; v < static_cast<int>(voices_.size()); v++) {
+        if (voices_[v].oneShotOf == index) FreeVoice(v); // Detach the buffer before it can be deleted
+    }
+    ReleaseBuffer(channel.soundKey);
 
-        // 1. Calculate Distance and Attenuation (Volume)
-        float dx = s.x - listenerX;
-        float dy = s.y - listenerY;
-        float distance = std::sqrt(dx * dx + dy * dy);
+    channels_.RemoveAt(index);
+}
 
-        // Calculate gain: 1.0 at distance 0, 0.0 at maxDistance, clamped between 0 and 1
-        float d = std::clamp(1.0f - (distance / s.maxDistance), 0.0f, 1.0f);
+/**
+ * @brief Resolves a sound handle to its channel slot.
+ *
+ * @param sound The handle of the sound.
+ * @return The slot index, or -1 if the handle is null or stale.
+ */
+int AudioManager::SlotOf(SoundHandle sound) const {
+    return channels_.Find(sound);
+}
 
-        // 2. Calculate Panning (Position)
-        // Dot product of (sound-listener vector) and listener's 'right' vector
-        float dotRight = dx * rightX + dy * rightY;
+/**
+ * @brief Returns the OpenAL source a sound is currently heard through.
+ *
+ * @param channel A live channel.
+ * @return The stream's own source, the bound voice's source, or nullptr while virtual.
+ */
+AudioManager::ShadowSource* AudioManager::SourceOf(const Channel& channel) {
+    if (channel.stream >= 0) return &streams_[channel.stream].source;
+    if (channel.voice >= 0) return &voices_[channel.voice].source;
+    return nullptr;
+}
 
-        // Normalize dot product to [-1.0, 1.0] for position/panning
-        float panning = std::clamp(dotRight / s.maxDistance, -1.0f, 1.0f);
+/**
+ * @brief Returns the uploaded cache entry of a loaded sound.
+ *
+ * @param channel A live channel.
+ * @return The entry, or null for streams and sounds still loading.
+ */
+const AudioManager::CachedBuffer* AudioManager::BufferOf(const Channel& channel) const {
+    auto it = bufferCache_.find(channel.soundKey);
+    if (it == bufferCache_.end() || it->second.buffer == 0) return nullptr;
+    return &it->second;
+}
 
-        // Set OpenAL Source Properties
-        // AL_POSITION takes (x, y, z) in listener space. For 2D panning, we use X as lateral position.
-        alSource3f(sources_[s.sourceIndex], AL_POSITION, panning, 0.0f, 0.0f);
-        alSourcef(sources_[s.sourceIndex], AL_GAIN, d);
+/**
+ * @brief Sets AL_GAIN unless the source already has that value.
+ */
+void AudioManager::ShadowSource::SetGain(float value) {
+    if (gain == value) return;
+    AL_CALL(alSourcef(id, AL_GAIN, value));
+    gain = value;
+}
+
+/**
+ * @brief Sets AL_PITCH unless the source already has that value.
+ */
+void AudioManager::ShadowSource::SetPitch(float value) {
+    if (pitch == value) return;
+    AL_CALL(alSourcef(id, AL_PITCH, value));
+    pitch = value;
+}
+
+/**
+ * @brief Places the source beside the listener, at a lateral position in [-1, 1].
+ *
+ * The source is listener-relative and within the reference distance, so
+ * OpenAL only pans it and the gain stays ours.
+ */
+void AudioManager::ShadowSource::SetPanning(float value) {
+    SetPosition(value, 0.0f, 0.0f, true);
+}
+
+/**
+ * @brief Places the source in the world for OpenAL to attenuate and pan (kWorld3D).
+ *
+ * The top-down world maps to the OpenAL ground plane: world X to X, world Y to Z.
+ *
+ * @param worldX The X-coordinate in world units.
+ * @param worldY The Y-coordinate in world units.
+ * @param range AL_MAX_DISTANCE: farther, the sound gets no quieter.
+ * @param rolloffFactor AL_ROLLOFF_FACTOR: how fast the sound gets quieter past 1 world unit.
+ */
+void AudioManager::ShadowSource::SetWorldPosition(float worldX, float worldY, float range, float rolloffFactor) {
+    SetPosition(worldX, 0.0f, worldY, false);
+    if (maxDistance != range) {
+        AL_CALL(alSourcef(id, AL_MAX_DISTANCE, range));
+        maxDistance = range;
+    }
+    if (rolloff != rolloffFactor) {
+        AL_CALL(alSourcef(id, AL_ROLLOFF_FACTOR, rolloffFactor));
+        rolloff = rolloffFactor;
     }
-    // 
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Sets AL_POSITION and AL_SOURCE_RELATIVE unless the source already has those values.
+ */
+void AudioManager::ShadowSource::SetPosition(float px, float py, float pz, bool isRelative) {
+    if (relative != static_cast<int>(isRelative)) {
+        AL_CALL(alSourcei(id, AL_SOURCE_RELATIVE, isRelative ? AL_TRUE : AL_FALSE));
+        relative = isRelative;
+    }
+    if (positioned && x == px && y == py && z == pz) return;
+    AL_CALL(alSource3f(id, AL_POSITION, px, py, pz));
+    x = px;
+    y = py;
+    z = pz;
+    positioned = true;
+}
+
+/**
+ * @brief Sets AL_LOOPING unless the source already has that value.
+ */
+void AudioManager::ShadowSource::SetLooping(bool value) {
+    if (looping == static_cast<int>(value)) return;
+    AL_CALL(alSourcei(id, AL_LOOPING, value ? AL_TRUE : AL_FALSE));
+    looping = value;
+}
+
+/**
+ * @brief Starts collecting source property changes into one batch.
+ *
+ * Changes made until the matching EndBatch are applied by the mixer all at
+ * once, so a tick never renders half of its gain and position updates. Uses
+ * AL_SOFT_deferred_updates when present, alcSuspendContext otherwise.
+ * Batches nest; only the outermost pair submits.
+ */
+void AudioManager::BeginBatch() {
+    if (batchDepth_++ > 0) return;
+    if (deferUpdates_) AL_CALL(deferUpdates_());
+    else if (context_) alcSuspendContext(context_);
+}
+
+/**
+ * @brief Applies the property changes collected since BeginBatch.
+ */
+void AudioManager::EndBatch() {
+    if (--batchDepth_ > 0) return;
+    if (deferUpdates_) AL_CALL(processUpdates_());
+    else if (context_) alcProcessContext(context_);
+}
+
+/**
+ * @brief Orders two channels for voice allocation: priority first, then gain.
+ *
+ * @return True if a should keep (or get) a voice rather than b.
+ */
+bool AudioManager::IsStronger(const Channel& a, const Channel& b) const {
+    return Outranks(a.priority, HeardGain(a), b.priority, HeardGain(b));
+}
+
+/**
+ * @brief Finds a voice for a sound of the given strength, stealing one if the pool is full.
+ *
+ * A free voice is used if there is one. Otherwise the weakest voice (lowest
+ * priority, then lowest gain) is taken, but only if its sound is strictly
+ * weaker than the requester. A channel losing its voice keeps playing
+ * virtually; a one-shot losing its voice simply ends.
+ *
+ * @param priority The priority of the requesting sound.
+ * @param gain The gain of the requesting sound.
+ * @return A free voice, or -1 if every voice is held by a stronger sound.
+ */
+int AudioManager::AcquireVoice(int priority, float gain) {
+    int weakest = -1;
+    int weakestPriority = 0;
+    float weakestGain = 0.0f;
+    for (int v = 0; v < static_cast<int>(voices_.size()); v++) {
+        const Voice& voice = voices_[v];
+        if (voice.channel < 0 && voice.oneShotOf < 0) return v;
+
+        int p = voice.channel >= 0 ? channels_[voice.channel].priority : voice.priority;
+        float g = voice.channel >= 0 ? HeardGain(channels_[voice.channel])
+            : voice.gain * buses_.Gain(channels_[voice.oneShotOf].bus);
+        if (weakest < 0 || Outranks(weakestPriority, weakestGain, p, g)) {
+            weakest = v;
+            weakestPriority = p;
+            weakestGain = g;
+        }
+    }
+
+    if (weakest < 0 || !Outranks(priority, gain, weakestPriority, weakestGain)) return -1;
+
+    if (voices_[weakest].channel >= 0) ReleaseVoice(voices_[weakest].channel, true);
+    else FreeVoice(weakest);
+    return weakest;
+}
+
+/**
+ * @brief Gives a virtual channel a voice, stealing one if the pool is full.
+ *
+ * @param index A live, loaded channel without a voice.
+ * @return True if the channel is now heard, false if it stays virtual.
+ */
+bool AudioManager::AssignVoice(int index) {
+    int voice = AcquireVoice(channels_[index].priority, HeardGain(channels_[index]));
+    if (voice < 0) return false;
+    BindVoice(index, voice);
+    return true;
+}
+
+/**
+ * @brief Attaches a channel to a free voice and starts it at its tracked position.
+ *
+ * The buffer is queued rather than attached, so a follower can later be
+ * queued behind it on the same voice (see QueueAfter).
+ *
+ * @param index A live, loaded channel without a voice.
+ * @param voice A free voice.
+ * @param startTime Audio clock time at which the mixer starts the voice (see
+ *        PlayAt), or -1 to start it now.
+ */
+void AudioManager::BindVoice(int index, int voice, int64_t startTime) {
+    Channel& channel = channels_[index];
+    ShadowSource& source = voices_[voice].source;
+
+    AL_CALL(alSourceQueueBuffers(source.id, 1, &channel.buffer));
+    source.SetLooping(channel.loop);
+    source.SetGain(HeardGain(channel));
+    source.SetPitch(1.0f); // One-shots leave their random pitch behind
+    PlaceSource(source, channel);
+    SetSourceLowpass(source, channel.lowpass);
+    AL_CALL(alSourcef(source.id, AL_SEC_OFFSET, channel.position));
+    if (startTime >= 0 && playAtTime_) AL_CALL(playAtTime_(source.id, startTime));
+    else AL_CALL(alSourcePlay(source.id));
+
+    voices_[voice].channel = index;
+    channel.voice = voice;
+}
+
+/**
+ * @brief Detaches a channel from its voice, stopping the voice.
+ *
+ * @param index A channel bound to a voice.
+ * @param keepPosition If true, the playback position is saved so the channel
+ *        can go on virtually and later resume where it left off.
+ */
+void AudioManager::ReleaseVoice(int index, bool keepPosition) {
+    Channel& channel = channels_[index];
+    ALuint source = voices_[channel.voice].source.id;
+
+    if (keepPosition) AL_CALL(alGetSourcef(source, AL_SEC_OFFSET, &channel.position));
+    FreeVoice(channel.voice);
+    channel.voice = -1;
+    channel.nextQueued = false; // The voice's whole queue went with it
+    if (!channel.staleKey.empty()) {
+        ReleaseBuffer(channel.staleKey);
+        channel.staleKey.clear();
+    }
+}
+
+/**
+ * @brief Stops a voice and returns it to the pool, invalidating its handles.
+ *
+ * @param voice The voice to free; a bound channel must be detached by the caller.
+ */
+void AudioManager::FreeVoice(int voice) {
+    Voice& v = voices_[voice];
+    AL_CALL(alSourceStop(v.source.id));
+    AL_CALL(alSourcei(v.source.id, AL_BUFFER, 0));
+
+    v.channel = -1;
+    v.oneShotOf = -1;
+    if (++v.generation == 0) v.generation = 1;
+}
+
+/**
+ * @brief Sets a channel's gain, pushing it to OpenAL only if it is being heard.
+ *
+ * @param index A live channel.
+ * @param gain The linear gain.
+ */
+void AudioManager::SetChannelGain(int index, float gain) {
+    Channel& channel = channels_[index];
+    channel.gain = gain;
+    if (ShadowSource* source = SourceOf(channel)) source->SetGain(HeardGain(channel));
+}
+
+/**
+ * @brief Returns the gain a channel is heard at: its own gain times its bus gain.
+ *
+ * @param channel A live channel.
+ */
+float AudioManager::HeardGain(const Channel& channel) const {
+    return channel.gain * buses_.Gain(channel.bus);
+}
+
+/**
+ * @brief Returns a voice to the pool if its sound has ended, and reports the end.
+ *
+ * @param voice A voice index; free or still playing voices are left alone.
+ */
+void AudioManager::EndIfStopped(int voice) {
+    Voice& v = voices_[voice];
+    if (v.channel < 0 && v.oneShotOf < 0) return;
+    ALint state;
+    AL_CALL(alGetSourcei(v.source.id, AL_SOURCE_STATE, &state));
+    if (state != AL_STOPPED) return;
+
+    if (v.oneShotOf >= 0) {
+        VoiceHandle handle;
+        handle.index = static_cast<uint32_t>(voice);
+        handle.generation = v.generation;
+        ReportEnded(v.oneShotOf, handle);
+        FreeVoice(voice);
+        return;
+    }
+
+    int index = v.channel;
+    Channel& channel = channels_[index];
+    ReleaseVoice(index, false);
+    channel.playing = false;
+    channel.position = 0.0f;
+
+    // A follower that could not share the voice starts now, late by up to a tick
+    if (channel.next >= 0) {
+        const CachedBuffer* buffer = BufferOf(channel);
+        int64_t late = channel.endsAt >= 0 ? std::max<int64_t>(ClockTime() - channel.endsAt, 0) : 0;
+        lastSeamError_ = buffer ? static_cast<int>(late * buffer->sampleRate / 1000000000) : 0;
+        StartFollower(index, 0.0f);
+    }
+    ReportEnded(index, VoiceHandle());
+}
+
+/**
+ * @brief Keeps the follower of a voiced sound ready for a gapless start (see QueueAfter).
+ *
+ * Shortly before the sound ends, the follower's buffer is queued behind it on
+ * the same voice, so the mixer goes from the last sample of one to the first
+ * sample of the other with no seam. Once the sound's buffer is processed the
+ * voice is handed over to the follower (see PassSeam).
+ *
+ * If the queue already holds a cancelled follower (see Unlink), the new one
+ * cannot go behind it: it gets a voice of its own instead, which the mixer
+ * starts at the predicted end with AL_SOFT_source_start_delay, and the first
+ * voice is cut once it runs into the cancelled buffer.
+ *
+ * @param voice A voice bound to a playing channel that has a follower or a stale queue.
+ * @param now The current audio clock time.
+ */
+void AudioManager::UpdateFollower(int voice, int64_t now) {
+    Voice& v = voices_[voice];
+    int index = v.channel;
+    Channel& channel = channels_[index];
+
+    if (channel.nextQueued || !channel.staleKey.empty()) {
+        ALint processed;
+        AL_CALL(alGetSourcei(v.source.id, AL_BUFFERS_PROCESSED, &processed));
+        if (processed >= 1) {
+            PassSeam(index);
+            return;
+        }
+        if (channel.nextQueued || channel.next < 0) return;
+    }
+
+    const CachedBuffer* current = BufferOf(channel);
+    float remaining;
+    if (getSourcei64_ && current && current->sampleRate > 0) {
+        // The offset and the clock come from the same mix, so the end is exact to the sample
+        ALint64SOFT values[2];
+        AL_CALL(getSourcei64_(v.source.id, AL_SAMPLE_OFFSET_CLOCK_SOFT, values));
+        int64_t frames = static_cast<int64_t>(current->bytes / FrameSize(current->format));
+        int64_t left = std::max<int64_t>(frames - (values[0] >> 32), 0);
+        remaining = static_cast<float>(left) / current->sampleRate;
+        if (values[0] > 0 || channel.endsAt < 0) channel.endsAt = values[1] + left * 1000000000 / current->sampleRate;
+    }
+    else {
+        float offset;
+        AL_CALL(alGetSourcef(v.source.id, AL_SEC_OFFSET, &offset));
+        remaining = std::max(channel.duration - offset, 0.0f);
+        // A stopped source reads offset 0; keep the estimate made while it played
+        if (offset > 0.0f || channel.endsAt < 0) channel.endsAt = now + static_cast<int64_t>(remaining * 1e9f);
+    }
+    if (remaining > kFollowLead) return;
+
+    int next = channel.next;
+    Channel& follower = channels_[next];
+    const CachedBuffer* buffer = BufferOf(follower);
+    // A follower with a voice of its own was scheduled already (possibly before we lost ours)
+    if (follower.loading || follower.voice >= 0 || !current || !buffer) return;
+
+    if (!channel.staleKey.empty()) {
+        // Without the start delay, or if no voice can be had, the follower starts on the cut (see PassSeam)
+        if (!playAtTime_ || HeardGain(follower) <= kAudibleGain) return;
+        int second = AcquireVoice(follower.priority, HeardGain(follower));
+        if (second < 0) return;
+        follower.position = 0.0f;
+        BindVoice(next, second, channel.endsAt); // Stays not playing until the seam
+        return;
+    }
+
+    // Only buffers of the same format can share a queue; the others start on stop (see EndIfStopped)
+    if (current->format != buffer->format || current->sampleRate != buffer->sampleRate) return;
+
+    AL_CALL(alSourceQueueBuffers(v.source.id, 1, &follower.buffer));
+    channel.nextQueued = true;
+}
+
+/**
+ * @brief Starts the follower of a sound that just ended (see QueueAfter).
+ *
+ * @param index The channel that ended; its follower link is cleared.
+ * @param offset Position at which the follower starts, in seconds.
+ */
+void AudioManager::StartFollower(int index, float offset) {
+    Channel& channel = channels_[index];
+    int next = channel.next;
+    channel.next = -1;
+    channel.endsAt = -1;
+
+    Channel& follower = channels_[next];
+    follower.follows = -1;
+    follower.playing = true;
+    if (follower.voice >= 0) return; // Already started by the mixer on its own voice
+    follower.position = follower.loading ? 0.0f : std::min(offset, follower.duration);
+    if (!follower.loading && HeardGain(follower) > kAudibleGain) AssignVoice(next);
+}
+
+/**
+ * @brief Ends a voiced sound whose buffer the mixer has just finished, handing on to its follower.
+ *
+ * A follower queued behind it takes the voice over where it is, already
+ * playing. A cancelled follower's buffer queued behind it is cut short, and
+ * the current follower, if any, starts: it is already running if it was
+ * scheduled on its own voice, otherwise it starts now, late by up to a tick.
+ *
+ * @param index A channel bound to a voice whose first queued buffer is processed.
+ */
+void AudioManager::PassSeam(int index) {
+    Channel& channel = channels_[index];
+    int voice = channel.voice;
+    Voice& v = voices_[voice];
+
+    if (channel.nextQueued) {
+        ALuint done;
+        AL_CALL(alSourceUnqueueBuffers(v.source.id, 1, &done));
+        int next = channel.next;
+        Channel& follower = channels_[next];
+        channel.voice = -1;
+        channel.next = -1;
+        channel.nextQueued = false;
+        channel.endsAt = -1;
+        channel.playing = false;
+        channel.position = 0.0f;
+
+        follower.follows = -1;
+        follower.voice = voice;
+        follower.playing = true;
+        follower.position = 0.0f;
+        v.channel = next;
+        v.source.SetLooping(follower.loop);
+        v.source.SetGain(HeardGain(follower));
+        PlaceSource(v.source, follower);
+
+        lastSeamError_ = 0;
+        ReportEnded(index, VoiceHandle());
+        return;
+    }
+
+    ReleaseVoice(index, false);
+    channel.playing = false;
+    channel.position = 0.0f;
+    if (channel.next >= 0) {
+        const Channel& follower = channels_[channel.next];
+        const CachedBuffer* buffer = BufferOf(channel);
+        int64_t late = channel.endsAt >= 0 ? std::max<int64_t>(ClockTime() - channel.endsAt, 0) : 0;
+        lastSeamError_ = follower.voice >= 0 || !buffer ? 0 : static_cast<int>(late * buffer->sampleRate / 1000000000);
+        StartFollower(index, 0.0f);
+    }
+    ReportEnded(index, VoiceHandle());
+}
+
+/**
+ * @brief Cancels the follower of a sound (see QueueAfter).
+ *
+ * Past the seam the follower is already heard, so the hand-over is completed
+ * (see PassSeam) and the sound ends here. Before it, a follower scheduled on
+ * its own voice is stopped before it makes a sound; a buffer already queued
+ * behind the sound cannot be taken back from OpenAL, so the voice plays on
+ * untouched and is cut when it gets there.
+ *
+ * @param index A live channel; nothing happens if it has no follower.
+ * @return False if the sound turned out to have ended, its follower taking over.
+ */
+bool AudioManager::Unlink(int index) {
+    Channel& channel = channels_[index];
+    if (channel.next < 0) return true;
+
+    if (channel.voice >= 0 && (channel.nextQueued || !channel.staleKey.empty())) {
+        ALint processed;
+        AL_CALL(alGetSourcei(voices_[channel.voice].source.id, AL_BUFFERS_PROCESSED, &processed));
+        if (processed > 0) {
+            // A follower already heard goes on; one that was to start on the cut is dropped
+            if (!channel.nextQueued && channels_[channel.next].voice < 0) {
+                channels_[channel.next].follows = -1;
+                channel.next = -1;
+            }
+            PassSeam(index);
+            return false;
+        }
+    }
+
+    int next = channel.next;
+    channels_[next].follows = -1;
+    if (channels_[next].voice >= 0) ReleaseVoice(next, false);
+    channel.next = -1;
+    channel.endsAt = -1;
+    if (channel.nextQueued) {
+        // The queue keeps using the buffer, so it must outlive an unload of the follower
+        channel.staleKey = channels_[next].soundKey;
+        bufferCache_[channel.staleKey].refCount++;
+    }
+    channel.nextQueued = false;
+    return true;
+}
+
+/**
+ * @brief Starts a sound whose PlayAt time has come, on the timeline.
+ *
+ * The sound starts as far in as the tick is late, so later sounds scheduled
+ * against the same clock stay aligned; the skipped samples are the seam error.
+ *
+ * @param index A live, loaded channel with a pending start.
+ * @param now The current audio clock time, at or past the start time.
+ */
+void AudioManager::StartScheduled(int index, int64_t now) {
+    Channel& channel = channels_[index];
+    float late = static_cast<float>(now - channel.startAt) / 1e9f;
+    const CachedBuffer* buffer = BufferOf(channel);
+    lastSeamError_ = buffer ? static_cast<int>(late * buffer->sampleRate) : 0;
+
+    channel.startAt = -1;
+    channel.playing = true;
+    channel.position = late;
+    if (HeardGain(channel) > kAudibleGain && channel.position < channel.duration) AssignVoice(index);
+}
+
+/**
+ * @brief Advances the voice pool by one tick.
+ *
+ * Finished voices are returned to the pool, virtual channels advance their
+ * position, inaudible channels give their voice up, and the strongest
+ * audible virtual channels are brought back (stealing from weaker ones).
+ *
+ * @param deltaTime The time elapsed since the last update, in seconds.
+ */
+void AudioManager::UpdateVoices(float deltaTime) {
+    int64_t now = ClockTime();
+
+    // Hand voices over to gapless followers first, so the end checks below see the new owner.
+    // A follower scheduled on a voice of its own is not playing yet and waits for its leader
+    for (int v = 0; v < static_cast<int>(voices_.size()); v++) {
+        int index = voices_[v].channel;
+        if (index < 0 || !channels_[index].playing) continue;
+        if (channels_[index].next >= 0 || !channels_[index].staleKey.empty()) UpdateFollower(v, now);
+    }
+
+    // Return voices whose sound has ended (non-looping channels and one-shots). With
+    // AL_SOFT_events only the sources OpenAL reported stopped are checked, otherwise
+    // (or if a report was lost) every busy voice is polled
+    bool pollAll = !eventCallback_ || stoppedOverflow_.exchange(false);
+    ALuint stopped;
+    while (stoppedSources_.Pop(&stopped)) {
+        auto it = sourceVoices_.find(stopped);
+        if (!pollAll && it != sourceVoices_.end()) EndIfStopped(it->second);
+    }
+    if (pollAll) {
+        for (int v = 0; v < static_cast<int>(voices_.size()); v++) EndIfStopped(v);
+    }
+
+    candidates_.clear();
+    for (int index = 0; index < channels_.SlotCount(); index++) {
+        if (!channels_.IsLive(index)) continue;
+        Channel& channel = channels_[index];
+        if (channel.startAt >= 0 && !channel.loading && now >= channel.startAt) StartScheduled(index, now);
+        if (!channel.playing || channel.loading || channel.stream >= 0) continue;
+
+        // Paused buses freeze their sounds where they are; muted ones only silence them
+        if (buses_.IsPaused(channel.bus)) {
+            if (channel.voice >= 0) ReleaseVoice(index, true);
+            continue;
+        }
+
+        if (channel.voice < 0) {
+            // Virtual channels keep time so they resume at the right offset
+            channel.position += deltaTime;
+            if (channel.position >= channel.duration) {
+                if (channel.loop && channel.duration > 0.0f) {
+                    channel.position = std::fmod(channel.position, channel.duration);
+                }
+                else {
+                    // A follower picks up exactly where this one ran out
+                    if (channel.next >= 0) {
+                        lastSeamError_ = 0;
+                        StartFollower(index, channel.position - channel.duration);
+                    }
+                    channel.playing = false;
+                    channel.position = 0.0f;
+                    ReportEnded(index, VoiceHandle());
+                    continue;
+                }
+            }
+        }
+        else if (HeardGain(channel) <= kAudibleGain) {
+            ReleaseVoice(index, true);
+        }
+
+        if (channel.voice < 0 && HeardGain(channel) > kAudibleGain) candidates_.push_back(index);
+    }
+
+    // Strongest first: once one candidate cannot get a voice, no weaker one can
+    std::sort(candidates_.begin(), candidates_.end(),
+        [this](int a, int b) { return IsStronger(channels_[a], channels_[b]); });
+    for (int index : candidates_) {
+        if (!AssignVoice(index)) break;
+    }
+}
+
+/**
+ * @brief Opens a WAV file for streamed playback and creates a sound for it.
+ *
+ * Unlike LoadWav, the track is never decoded as a whole: a background reader
+ * keeps a small ring of buffers queued on the source (see AudioStream), so the
+ * resident PCM stays at a few hundred KB however long the track is. The
+ * returned handle works with every other method (Play, Stop, Crossfade, ...).
+ *
+ * Streams get a source of their own outside the voice pool: their buffer
+ * queue cannot be moved between sources, so they are never virtualized.
+ *
+ * The file is opened on the calling thread without holding the lock the
+ * audio thread ticks under; while it runs, the source is created on its next
+ * tick (see AttachStreams), before the commands posted after this call.
+ *
+ * @param filename The path to the WAV file.
+ * @return The handle of the newly created sound, or a null handle on failure.
+ */
+SoundHandle AudioManager::OpenStream(const std::string& filename) {
+    std::unique_ptr<AudioStream> stream(new AudioStream());
+    if (!stream->Open(filename, floatFormats_)) return SoundHandle();
+
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    int index = CreateChannel(std::string()); // Streams own their buffers
+    channels_[index].loading = true; // Until it has a source
+    pendingStreams_.push_back({ channels_.HandleAt(index), std::move(stream) });
+    if (!audioThreaded_) ProcessLoads(); // The calling thread is the one that ticks
+    return channels_.HandleAt(index);
+}
+
+/**
+ * @brief Gives the streams opened since the last tick their source (see OpenStream).
+ *
+ * Streams unloaded in the meantime are dropped.
+ */
+void AudioManager::AttachStreams() {
+    for (auto& pending : pendingStreams_) {
+        int index = SlotOf(pending.sound);
+        if (index < 0) continue;
+
+        ShadowSource source;
+        AL_CALL(alGenSources(1, &source.id));
+        source.SetGain(1.0f); // Default volume
+        source.SetPanning(0.0f); // Listener-relative, so it stays on the listener in kWorld3D
+        reverb_.Attach(source.id);
+
+        channels_[index].loading = false;
+        {
+            std::lock_guard<std::mutex> lock(streamMutex_);
+            channels_[index].stream = static_cast<int>(streams_.size());
+            streams_.push_back({ index, source, std::move(pending.stream) });
+        }
+
+        // The reader is only needed once there is something to stream; in loopback mode Render reads
+        if (!renderSamples_ && !streamReader_.joinable()) {
+            streamReaderQuit_ = false;
+            streamReader_ = std::thread(&AudioManager::StreamReaderLoop, this);
+        }
+    }
+    pendingStreams_.clear();
+}
+
+/**
+ * @brief Starts a streamed source from the beginning.
+ *
+ * @param sound The handle returned by OpenStream.
+ * @param loop If true, the track wraps around instead of ending.
+ */
+void AudioManager::PlayStream(SoundHandle sound, bool loop) {
+    Command command;
+    command.type = Command::kPlayStream;
+    command.sound = sound;
+    command.loop = loop;
+    if (Post(command)) return;
+
+    int index = SlotOf(sound);
+    if (index < 0 || channels_[index].stream < 0) return;
+    StartStream(streams_[channels_[index].stream], loop);
+}
+
+/**
+ * @brief Body of the background reader thread.
+ *
+ * Refills the staging blocks of every stream whenever Update consumes some,
+ * with a short timeout as a safety net. The streams are filled from a copy
+ * of the list, so streamMutex_ is never held during a read and the tick
+ * never waits for the disk (see AudioStream::FillBlocks).
+ */
+void AudioManager::StreamReaderLoop() {
+    std::vector<std::shared_ptr<AudioStream>> streams;
+    std::unique_lock<std::mutex> lock(streamMutex_);
+    while (!streamReaderQuit_) {
+        for (const auto& slot : streams_) {
+            if (slot.stream) streams.push_back(slot.stream);
+        }
+
+        lock.unlock();
+        for (const auto& stream : streams) stream->FillBlocks();
+        streams.clear(); // A stream unloaded meanwhile is freed here, already closed (see Unload)
+        lock.lock();
+
+        streamWake_.wait_for(lock, std::chrono::milliseconds(20));
+    }
+}
+
+/**
+ * @brief Starts a sound the way Crossfade needs it, whatever its kind.
+ *
+ * Streams restart with their last loop setting; loaded sounds restart with
+ * their last loop setting and priority.
+ *
+ * @param index A live channel slot.
+ */
+void AudioManager::StartSource(int index) {
+    Channel& channel = channels_[index];
+    if (channel.stream >= 0) {
+        StreamSlot& slot = streams_[channel.stream];
+        StartStream(slot, slot.stream->IsLooping());
+    }
+    else {
+        PlayChannel(index, channel.loop, channel.priority);
+    }
+}
+
+/**
+ * @brief Starts a stream from the beginning and wakes the reader to fill it.
+ *
+ * @param slot A stream slot with an open stream.
+ * @param loop If true, the track wraps around instead of ending.
+ */
+void AudioManager::StartStream(StreamSlot& slot, bool loop) {
+    slot.stream->Start(slot.source.id, loop);
+    slot.playing = true;
+    channels_[slot.channel].paused = false;
+    if (buses_.IsPaused(channels_[slot.channel].bus)) AL_CALL(alSourcePause(slot.source.id));
+    streamWake_.notify_one();
+}
+
+/**
+ * @brief Stops a sound, draining the buffer queue if it is a stream.
+ *
+ * @param index A live channel slot.
+ */
+void AudioManager::StopSource(int index) {
+    Channel& channel = channels_[index];
+    fades_.Cancel(index);
+    channel.paused = false;
+    if (channel.stream >= 0) {
+        StreamSlot& slot = streams_[channel.stream];
+        slot.stream->Stop(slot.source.id);
+        slot.playing = false;
+        return;
+    }
+
+    if (channel.follows >= 0) Unlink(channel.follows); // The sound we follow goes on alone
+    if (channel.voice >= 0) ReleaseVoice(index, false);
+    Unlink(index);
+    channel.playing = false; // Also cancels a Play waiting for its buffer
+    channel.position = 0.0f;
+    channel.startAt = -1;
+}
+
+/**
+ * @brief Starts playback of a sound from the beginning.
+ *
+ * The sound takes a free voice from the pool. When the pool is full it steals
+ * the voice of the weakest playing sound (lower priority, or same priority and
+ * quieter); if every voice is held by a stronger sound, or this one is
+ * inaudible, it plays virtually: its position keeps advancing and Update
+ * gives it a voice as soon as it can win one.
+ *
+ * Streamed sounds (see OpenStream) are forwarded to PlayStream. Sounds still
+ * loading (see LoadWavAsync) start as soon as their buffer arrives.
+ *
+ * @param sound The handle of the sound to play (returned by LoadWav).
+ * @param loop If true, the sound will loop continuously.
+ * @param priority Voice priority; higher values are stolen last.
+ */
+void AudioManager::Play(SoundHandle sound, bool loop, int priority) {
+    Command command;
+    command.type = Command::kPlay;
+    command.sound = sound;
+    command.loop = loop;
+    command.priority = priority;
+    if (Post(command)) return;
+
+    int index = SlotOf(sound);
+    if (index >= 0) PlayChannel(index, loop, priority);
+}
+
+/**
+ * @brief Plays the sound in a slot (see Play).
+ *
+ * @param index A live channel slot.
+ * @param loop If true, the sound will loop continuously.
+ * @param priority Voice priority.
+ */
+void AudioManager::PlayChannel(int index, bool loop, int priority) {
+    Channel& channel = channels_[index];
+    if (channel.stream >= 0) {
+        StartStream(streams_[channel.stream], loop);
+        return;
+    }
+
+    if (channel.follows >= 0) Unlink(channel.follows); // Playing a follower now cancels its queued start
+    if (channel.voice >= 0) ReleaseVoice(index, false);
+    channel.startAt = -1;
+    channel.playing = true;
+    channel.paused = false;
+    channel.loop = loop;
+    channel.priority = priority;
+    channel.position = 0.0f;
+
+    // Sounds still loading start once the buffer arrives (see ProcessLoads)
+    if (channel.loading || HeardGain(channel) <= kAudibleGain) return;
+    AssignVoice(index);
+}
+
+/**
+ * @brief Stops playback for the audio source at the specified index.
+ *
+ * @param sound The handle of the sound to stop.
+ */
+void AudioManager::Stop(SoundHandle sound) {
+    Command command;
+    command.type = Command::kStop;
+    command.sound = sound;
+    if (Post(command)) return;
+
+    int index = SlotOf(sound);
+    if (index < 0) return;
+    StopSource(index);
+}
+
+/**
+ * @brief Starts playback of a sound at a given time of the audio clock.
+ *
+ * With ALC_SOFT_device_clock and AL_SOFT_source_start_delay the voice is set
+ * up right away and the mixer starts it on the exact sample. Otherwise the
+ * first Update at or past the time starts it, as far in as the tick is late,
+ * so the sound stays on the timeline (see LastSeamError). A time already past
+ * starts the sound on the next Update. Streams cannot be scheduled.
+ *
+ * @param sound The handle of a loaded sound.
+ * @param clockTimeNs The start time, in nanoseconds of ClockTime.
+ * @param loop If true, the sound will loop continuously.
+ * @param priority Voice priority; higher values are stolen last.
+ */
+void AudioManager::PlayAt(SoundHandle sound, int64_t clockTimeNs, bool loop, int priority) {
+    Command command;
+    command.type = Command::kPlayAt;
+    command.sound = sound;
+    command.time = clockTimeNs;
+    command.loop = loop;
+    command.priority = priority;
+    if (Post(command)) return;
+
+    int index = SlotOf(sound);
+    if (index < 0 || channels_[index].stream >= 0) return;
+    StopSource(index);
+    Channel& channel = channels_[index];
+    channel.loop = loop;
+    channel.priority = priority;
+
+    if (playAtTime_ && !channel.loading && HeardGain(channel) > kAudibleGain && clockTimeNs > ClockTime()) {
+        int voice = AcquireVoice(priority, HeardGain(channel));
+        if (voice >= 0) {
+            channel.playing = true;
+            BindVoice(index, voice, clockTimeNs);
+            lastSeamError_ = 0;
+            return;
+        }
+    }
+    channel.startAt = clockTimeNs; // Started by UpdateVoices
+}
+
+/**
+ * @brief Makes a sound start the moment another one ends, without a gap.
+ *
+ * When both are loaded with the same format and sample rate, the next sound
+ * is queued behind the current one on its voice shortly before the end, so
+ * the seam is sample-exact. Otherwise it starts on the Update that sees the
+ * current sound stop. The current sound stops looping, its current pass
+ * being the last one. Each sound has at most one follower: queueing another,
+ * or a null handle, replaces it without touching the current sound, and the
+ * new seam stays exact where AL_SOFT_source_start_delay is available (see
+ * UpdateFollower). Past the seam, before Update has seen it, the follower
+ * already queued is heard and stays: the current sound ends and the next one
+ * is not linked. Stopping either sound, or playing the next one directly,
+ * cancels the link.
+ *
+ * @param current A loaded sound, playing or not.
+ * @param next The loaded sound to start after it; it is stopped if playing.
+ * @param loop If true, the next sound loops once started.
+ */
+void AudioManager::QueueAfter(SoundHandle current, SoundHandle next, bool loop) {
+    Command command;
+    command.type = Command::kQueueAfter;
+    command.sound = current;
+    command.target = next;
+    command.loop = loop;
+    if (Post(command)) return;
+
+    int index = SlotOf(current);
+    if (index < 0 || channels_[index].stream >= 0 || !Unlink(index)) return;
+
+    int follower = SlotOf(next);
+    if (follower < 0 || follower == index || channels_[follower].stream >= 0) return;
+    Channel& channel = channels_[follower];
+    if (channel.follows >= 0) Unlink(channel.follows);
+    if (channel.voice >= 0) ReleaseVoice(follower, false);
+    channel.playing = false;
+    channel.startAt = -1;
+    channel.loop = loop;
+    channel.follows = index;
+
+    Channel& leader = channels_[index];
+    leader.next = follower;
+    leader.loop = false;
+    if (ShadowSource* source = SourceOf(leader)) source->SetLooping(false);
+}
+
+/**
+ * @brief Returns the current time of the audio clock, for PlayAt.
+ *
+ * This is the device clock when ALC_SOFT_device_clock is available, which
+ * advances with the samples actually mixed; otherwise the steady clock, or
+ * in loopback mode the time rendered so far.
+ *
+ * @return The time in nanoseconds.
+ */
+int64_t AudioManager::ClockTime() {
+    if (getInteger64_) {
+        ALCint64SOFT time = 0;
+        getInteger64_(device_, ALC_DEVICE_CLOCK_SOFT, 1, &time);
+        return time;
+    }
+    if (renderSamples_) return renderedFrames_ * 1000000000 / renderRate_;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Returns the error of the last seam between two scheduled sounds.
+ *
+ * Gapless followers (see QueueAfter) and PlayAt with the start-delay
+ * extension are exact and report 0. A follower that could not share the
+ * voice reports how late it started, and a tick-scheduled PlayAt how many
+ * samples it skipped to stay on the timeline.
+ *
+ * @return The error in sample frames of the sound involved.
+ */
+int AudioManager::LastSeamError() {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    return lastSeamError_;
+}
+
+/**
+ * @brief Returns what the audio system costs right now (see AudioStats).
+ *
+ * Counting the voices and the resident PCM walks every sound, so this is
+ * meant for a debug overlay or a profiling dump, not for every frame.
+ */
+AudioStats AudioManager::GetStats() {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    AudioStats stats = stats_;
+    for (const Voice& voice : voices_) {
+        if (voice.channel >= 0 || voice.oneShotOf >= 0) stats.activeVoices++;
+    }
+    for (int index = 0; index < channels_.SlotCount(); index++) {
+        if (!channels_.IsLive(index)) continue;
+        const Channel& channel = channels_[index];
+        if (channel.playing && channel.voice < 0 && channel.stream < 0) stats.virtualVoices++;
+    }
+    stats.fades = fades_.Size();
+
+    // Streams hold their blocks twice: staged by the reader and queued on the source
+    for (const auto& entry : bufferCache_) stats.residentBytes += entry.second.bytes;
+    stats.residentBytes += streams_.size() * 2 * AudioStream::kBufferCount * AudioStream::kBlockSize;
+    return stats;
+}
+
+/**
+ * @brief Updates the state of ongoing effects, primarily crossfading.
+ *
+ * This method must be called regularly within the main game loop to progress
+ * timed audio effects like crossfades, to keep streamed tracks fed, to
+ * finish background loads and to hand voices to the sounds that need them.
+ * All source changes of one update are submitted as a single batch.
+ *
+ * Playbacks that ended since the previous call are then reported to the end
+ * callback (see SetEndCallback), on the calling thread. While the audio
+ * thread runs, calling Update only does this reporting.
+ *
+ * @param deltaTime The time elapsed since the last update, typically in seconds.
+ */
+void AudioManager::Update(float deltaTime) {
+    // The audio thread, when running, ticks on its own clock
+    if (audioThreaded_ && tlsAudioThreadOwner != this) {
+        DispatchEvents();
+        return;
+    }
+    StatsTimer timer(&stats_.updateMicros, &stats_.updateMaxMicros);
+    AUDIO_STAT(stats_.BeginTick());
+    BeginBatch();
+
+    // Attach buffers that finished loading in the background
+    ProcessLoads();
+
+    ApplyFades(deltaTime);
+    ApplyDucking(deltaTime);
+    ApplyBuses();
+    UpdateVoices(deltaTime);
+    reverb_.Update(listenerX_, listenerY_, deltaTime);
+
+    // Recycle played stream buffers and wake the reader if blocks were consumed. Paused
+    // streams are left alone, since Service would restart them as if they had underrun
+    int consumed = 0;
+    for (auto& slot : streams_) {
+        if (!slot.stream) continue;
+        const Channel& channel = channels_[slot.channel];
+        if (channel.paused || buses_.IsPaused(channel.bus)) continue;
+        consumed += slot.stream->Service(slot.source.id);
+        if (slot.playing && !slot.stream->IsActive()) {
+            slot.playing = false;
+            ReportEnded(slot.channel, VoiceHandle());
+        }
+    }
+    if (consumed > 0) streamWake_.notify_one();
+
+    EndBatch();
+    if (!audioThreaded_) DispatchEvents();
+}
+
+/**
+ * @brief Advances a loopback session by deltaTime and mixes that much audio.
+ *
+ * Runs Update with the same deltaTime, then renders the matching number of
+ * stereo frames; the fraction of a frame left over is carried to the next
+ * call, so the output never drifts from the caller's clock. The frames can be
+ * read through RenderedSamples until the next call, and are appended to the
+ * capture file if one is open (see StartCapture).
+ *
+ * @param deltaTime The time to render, in seconds.
+ * @return The number of frames rendered, or 0 if not in loopback mode.
+ */
+int AudioManager::Render(float deltaTime) {
+    if (!renderSamples_) return 0;
+
+    // Streams are topped up here, so their contents never depend on a thread's timing
+    {
+        std::lock_guard<std::mutex> lock(streamMutex_);
+        for (auto& slot : streams_) {
+            if (slot.stream) slot.stream->FillBlocks();
+        }
+    }
+    Update(deltaTime);
+
+    renderPending_ += static_cast<double>(deltaTime) * renderRate_;
+    int frames = static_cast<int>(renderPending_);
+    renderPending_ -= frames;
+    if (frames <= 0) {
+        renderOutput_.clear();
+        return 0;
+    }
+
+    size_t count = static_cast<size_t>(frames) * 2;
+    renderOutput_.resize(count);
+    if (renderType_ == ALC_FLOAT_SOFT) {
+        renderSamples_(device_, renderOutput_.data(), frames);
+    }
+    else {
+        renderShorts_.resize(count);
+        renderSamples_(device_, renderShorts_.data(), frames);
+        for (size_t i = 0; i < count; i++) renderOutput_[i] = renderShorts_[i] / 32768.0f;
+    }
+    renderedFrames_ += frames;
+
+    if (capture_.IsOpen()) {
+        if (renderType_ == ALC_FLOAT_SOFT) {
+            renderShorts_.resize(count);
+            for (size_t i = 0; i < count; i++) {
+                float sample = std::min(std::max(renderOutput_[i], -1.0f), 1.0f);
+                renderShorts_[i] = static_cast<int16_t>(std::lrint(sample * 32767.0f));
+            }
+        }
+        capture_.Write(renderShorts_.data(), count);
+    }
+    return frames;
+}
+
+/**
+ * @brief Returns the interleaved stereo frames of the last Render.
+ *
+ * Full scale is [-1, 1]; a float mix is not clipped, so it may go past that.
+ * The pointer stays valid until the next Render or Close.
+ */
+const float* AudioManager::RenderedSamples() const {
+    return renderOutput_.data();
+}
+
+/**
+ * @brief Starts writing everything Render mixes to a 16-bit stereo WAV file.
+ *
+ * A capture already running is finished first.
+ *
+ * @param filename The path of the file to create.
+ * @return True if the file was created; false on failure or outside loopback mode.
+ */
+bool AudioManager::StartCapture(const std::string& filename) {
+    if (!renderSamples_) return false;
+    return capture_.Open(filename, 2, renderRate_);
+}
+
+/**
+ * @brief Finishes the capture file started by StartCapture.
+ *
+ * Also done by Close.
+ *
+ * @return True if the whole file was written.
+ */
+bool AudioManager::StopCapture() {
+    return capture_.Close();
+}
+
+/**
+ * @brief Sets the function called whenever a playback reaches its end.
+ *
+ * Reported are sounds that played to the end (see Play, PlayStream), one-shots
+ * that played to the end (see PlayOneShot) and pending plays of sounds whose
+ * file failed to load. Stopped, stolen and looping playbacks are not reported.
+ * The callback runs inside Update, on the thread that calls it, so it may
+ * call back into the manager; this replaces polling IsPlaying every frame.
+ * Events are detected per tick, through AL_SOFT_events when the driver has it.
+ *
+ * @param callback The function to call, or an empty function to stop reporting.
+ */
+void AudioManager::SetEndCallback(std::function<void(const PlaybackEnded&)> callback) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    endCallback_ = std::move(callback);
+    reportEnds_ = static_cast<bool>(endCallback_);
+}
+
+/**
+ * @brief Queues an end-of-playback event for the next DispatchEvents.
+ *
+ * Only called with stateMutex_ held, which keeps endedEvents_ to one producer
+ * at a time: the tick, or Unload handing a sound over to its follower.
+ *
+ * @param index The channel whose playback ended.
+ * @param voice The one-shot that ended, or a null handle.
+ */
+void AudioManager::ReportEnded(int index, VoiceHandle voice) {
+    if (!reportEnds_) return;
+    PlaybackEnded event;
+    event.sound = channels_.HandleAt(index);
+    event.voice = voice;
+    endedEvents_.Push(event); // Dropped if the game stopped calling Update
+}
+
+/**
+ * @brief Hands the queued end-of-playback events to the end callback.
+ */
+void AudioManager::DispatchEvents() {
+    PlaybackEnded event;
+    while (endedEvents_.Pop(&event)) {
+        if (endCallback_) endCallback_(event);
+    }
+}
+
+/**
+ * @brief AL_SOFT_events callback, run on an OpenAL thread.
+ *
+ * Only forwards the stopped source to the ticking thread, which checks and
+ * frees its voice (see UpdateVoices). Never blocks: if the queue is full the
+ * next tick falls back to polling every voice.
+ */
+void AL_APIENTRY AudioManager::OnSourceEvent(ALenum type, ALuint object, ALuint param, ALsizei,
+    const ALchar*, void* userParam) {
+    if (type != AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT || param != AL_STOPPED) return;
+    AudioManager* self = static_cast<AudioManager*>(userParam);
+    if (!self->stoppedSources_.Push(object)) self->stoppedOverflow_ = true;
+}
+
+/**
+ * @brief Crossfades between two sounds over a specified duration.
+ *
+ * Starts the 'to' sound if it is not playing yet and ramps it up to full
+ * volume while the 'from' sound ramps down to silence and then stops. Both
+ * ramps start from the current gains, so a crossfade can interrupt another
+ * one (or reverse it) without any sound being left at a partial gain.
+ *
+ * @param from The sound to fade out.
+ * @param to The sound to fade in.
+ * @param duration The length of the transition in seconds.
+ * @param curve The shape of both ramps; kEqualPower keeps the loudness steady.
+ */
+void AudioManager::Crossfade(SoundHandle from, SoundHandle to, float duration, FadeManager::Curve curve) {
+    Command command;
+    command.type = Command::kCrossfade;
+    command.sound = from;
+    command.target = to;
+    command.duration = duration;
+    command.curve = curve;
+    if (Post(command)) return;
+
+    int fromIndex = SlotOf(from);
+    int toIndex = SlotOf(to);
+    if (fromIndex < 0 || toIndex < 0 || fromIndex == toIndex) return;
+
+    // A sound still playing (e.g. one an earlier crossfade is fading out) fades back in from where it is
+    const Channel& target = channels_[toIndex];
+    bool playing = target.stream >= 0 ? streams_[target.stream].playing : target.playing;
+    if (!playing) {
+        SetChannelGain(toIndex, 0.0f);
+        StartSource(toIndex);
+    }
+
+    fades_.Start(fromIndex, channels_[fromIndex].gain, 0.0f, duration, curve, FadeManager::kStop);
+    fades_.Start(toIndex, channels_[toIndex].gain, 1.0f, duration, curve, FadeManager::kNone);
+}
+
+/**
+ * @brief Ramps the volume of a sound to a new gain.
+ *
+ * The ramp starts from the current gain and replaces any ramp the sound
+ * already has; SetVolume, Stop and Unload cancel it. Any number of sounds can
+ * fade at once.
+ *
+ * @param sound The handle of the sound.
+ * @param gain The linear gain at the end of the ramp.
+ * @param duration The length of the ramp in seconds.
+ * @param curve The shape of the ramp.
+ * @param action What to do with the sound once the ramp ends: stop it, pause
+ *        it (see Pause) or hand its voice back to the pool while it plays on
+ *        virtually.
+ */
+void AudioManager::FadeTo(SoundHandle sound, float gain, float duration, FadeManager::Curve curve,
+    FadeManager::Action action) {
+    Command command;
+    command.type = Command::kFadeTo;
+    command.sound = sound;
+    command.value = gain;
+    command.duration = duration;
+    command.curve = curve;
+    command.action = action;
+    if (Post(command)) return;
+
+    int index = SlotOf(sound);
+    if (index < 0) return;
+    fades_.Start(index, channels_[index].gain, gain, duration, curve, action);
+}
+
+/**
+ * @brief Advances every gain ramp and carries out the actions of those that ended.
+ *
+ * @param deltaTime The time elapsed since the last update, in seconds.
+ */
+void AudioManager::ApplyFades(float deltaTime) {
+    fades_.Advance(deltaTime);
+    for (int i = 0; i < fades_.Size(); i++) SetChannelGain(fades_.Target(i), fades_.Gain(i));
+
+    for (const FadeManager::Completion& done : fades_.Completed()) {
+        SetChannelGain(done.target, done.gain);
+        switch (done.action) {
+        case FadeManager::kNone:  break;
+        case FadeManager::kStop:  StopSource(done.target); break;
+        case FadeManager::kPause: PauseChannel(done.target); break;
+        case FadeManager::kReleaseVoice:
+            if (channels_[done.target].voice >= 0) ReleaseVoice(done.target, true);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Pauses a playing sound, keeping its position for Resume.
+ *
+ * A paused sound holds no voice and does not advance. IsPlaying reports it as
+ * not playing; Play and Stop clear the pause.
+ *
+ * @param sound The handle of the sound.
+ */
+void AudioManager::Pause(SoundHandle sound) {
+    Command command;
+    command.type = Command::kPause;
+    command.sound = sound;
+    if (Post(command)) return;
+
+    int index = SlotOf(sound);
+    if (index >= 0) PauseChannel(index);
+}
+
+/**
+ * @brief Resumes a sound paused by Pause where it left off.
+ *
+ * @param sound The handle of the sound.
+ */
+void AudioManager::Resume(SoundHandle sound) {
+    Command command;
+    command.type = Command::kResume;
+    command.sound = sound;
+    if (Post(command)) return;
+
+    int index = SlotOf(sound);
+    if (index >= 0) ResumeChannel(index);
+}
+
+/**
+ * @brief Pauses the sound in a slot (see Pause).
+ *
+ * @param index A live channel slot.
+ */
+void AudioManager::PauseChannel(int index) {
+    Channel& channel = channels_[index];
+    if (channel.stream >= 0) {
+        StreamSlot& slot = streams_[channel.stream];
+        if (!slot.playing) return;
+        AL_CALL(alSourcePause(slot.source.id));
+        slot.playing = false;
+        channel.paused = true;
+        return;
+    }
+
+    if (!channel.playing) return;
+    if (channel.voice >= 0) ReleaseVoice(index, true);
+    channel.playing = false;
+    channel.paused = true;
+}
+
+/**
+ * @brief Resumes the sound in a slot (see Resume).
+ *
+ * @param index A live channel slot.
+ */
+void AudioManager::ResumeChannel(int index) {
+    Channel& channel = channels_[index];
+    if (!channel.paused) return;
+    channel.paused = false;
+    if (channel.stream >= 0) {
+        StreamSlot& slot = streams_[channel.stream];
+        if (!buses_.IsPaused(channel.bus)) AL_CALL(alSourcePlay(slot.source.id));
+        slot.playing = true;
+        return;
+    }
+
+    channel.playing = true;
+    if (!channel.loading && HeardGain(channel) > kAudibleGain) AssignVoice(index);
+}
+
+/**
+ * @brief Adds a mixer bus under an existing one (see SetBus).
+ *
+ * Every sound starts on the master bus. A bus scales, mutes and pauses all the
+ * sounds routed to it and to the buses below it, so turning down all the music
+ * is one call whatever the number of sounds.
+ *
+ * @param name A name not used by any other bus ("master" is taken).
+ * @param parent The bus this one is mixed into.
+ * @return The id of the new bus, or -1 if the name is taken or the parent does not exist.
+ */
+int AudioManager::CreateBus(const std::string& name, int parent) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    return buses_.Create(name, parent);
+}
+
+/**
+ * @brief Returns the id of a bus by name, or -1 if there is none.
+ */
+int AudioManager::GetBus(const std::string& name) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    return buses_.Find(name);
+}
+
+/**
+ * @brief Routes a sound, its one-shots included, to a bus.
+ *
+ * @param sound The handle of the sound.
+ * @param bus The id returned by CreateBus, or BusMixer::kMaster.
+ */
+void AudioManager::SetBus(SoundHandle sound, int bus) {
+    Command command;
+    command.type = Command::kSetBus;
+    command.sound = sound;
+    command.bus = bus;
+    if (Post(command)) return;
+
+    int index = SlotOf(sound);
+    if (index < 0 || !buses_.IsValid(bus)) return;
+    Channel& channel = channels_[index];
+    bool wasPaused = buses_.IsPaused(channel.bus);
+    channel.bus = bus;
+    SetChannelGain(index, channel.gain);
+
+    // Streams keep their source, so it follows the pause state of the new bus right away
+    if (channel.stream >= 0 && streams_[channel.stream].playing && wasPaused != buses_.IsPaused(bus)) {
+        ToggleBusPause(streams_[channel.stream].source.id, buses_.IsPaused(bus));
+    }
+}
+
+/**
+ * @brief Sets the volume of a bus, applied on the next Update.
+ *
+ * @param bus The id returned by CreateBus, or BusMixer::kMaster.
+ * @param gain The linear gain; it multiplies the gain of every sound below the bus.
+ */
+void AudioManager::SetBusVolume(int bus, float gain) {
+    Command command;
+    command.type = Command::kSetBusVolume;
+    command.bus = bus;
+    command.value = gain;
+    if (Post(command)) return;
+
+    if (buses_.IsValid(bus)) buses_.SetVolume(bus, gain);
+}
+
+/**
+ * @brief Mutes or unmutes a bus, applied on the next Update.
+ *
+ * Muted sounds keep playing virtually and give their voices up, as if their
+ * volume were 0; the bus volume is kept for when it is unmuted.
+ *
+ * @param bus The id returned by CreateBus, or BusMixer::kMaster.
+ * @param muted True to mute.
+ */
+void AudioManager::SetBusMuted(int bus, bool muted) {
+    Command command;
+    command.type = Command::kSetBusMuted;
+    command.bus = bus;
+    command.enabled = muted;
+    if (Post(command)) return;
+
+    if (buses_.IsValid(bus)) buses_.SetMuted(bus, muted);
+}
+
+/**
+ * @brief Pauses or resumes every sound below a bus, applied on the next Update.
+ *
+ * Unlike Pause, this does not change what IsPlaying reports: the sounds are
+ * held where they are and go on when the bus is resumed.
+ *
+ * @param bus The id returned by CreateBus, or BusMixer::kMaster.
+ * @param paused True to pause.
+ */
+void AudioManager::SetBusPaused(int bus, bool paused) {
+    Command command;
+    command.type = Command::kSetBusPaused;
+    command.bus = bus;
+    command.enabled = paused;
+    if (Post(command)) return;
+
+    if (buses_.IsValid(bus)) buses_.SetPaused(bus, paused);
+}
+
+/**
+ * @brief Makes a bus duck while another one plays (sidechain).
+ *
+ * For example, AddDuckRule(music, stingers, -8.0f, 0.1f, 1.0f) lowers the
+ * music by 8 dB within 0.1 s whenever any voice on the stinger bus (or below
+ * it) is playing, and brings it back over 1 s once they are all done. The
+ * rules run on the ticking thread from the voice pool alone, so the game
+ * never has to push volumes every frame; the attenuation multiplies the
+ * bus volume rather than replacing it.
+ *
+ * @param bus The bus to lower.
+ * @param trigger The bus whose playing voices lower it.
+ * @param depthDb The attenuation in dB; the sign is ignored.
+ * @param attack Seconds to reach the full depth.
+ * @param release Seconds to come back to full volume.
+ * @return The id of the rule, or -1 if a bus does not exist.
+ */
+int AudioManager::AddDuckRule(int bus, int trigger, float depthDb, float attack, float release) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    return buses_.AddDuck(bus, trigger, depthDb, attack, release);
+}
+
+/**
+ * @brief Removes a duck rule; its bus returns to full volume on the next Update.
+ *
+ * @param rule The id returned by AddDuckRule.
+ */
+void AudioManager::RemoveDuckRule(int rule) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    buses_.RemoveDuck(rule);
+}
+
+/**
+ * @brief Divides the map into cells for reverb zones, clearing every cell to no reverb.
+ *
+ * The listener position given to UpdateSpatial2D picks the cell, and the
+ * cell's zone picks the reverb heard on every sound (see AddReverbZone).
+ * The lookup is one array access per tick whatever the size of the map.
+ *
+ * @param width The number of columns, e.g. the width of the board.
+ * @param height The number of rows.
+ * @param cellSize The size of a cell in the units of the listener position.
+ */
+void AudioManager::SetReverbGrid(int width, int height, float cellSize) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    reverb_.SetGrid(width, height, cellSize);
+}
+
+/**
+ * @brief Registers a reverb preset for a zone of the map.
+ *
+ * The presets of efx-presets.h can be passed directly:
+ * AddReverbZone(EFX_REVERB_PRESET_LIVINGROOM). Entering a zone blends its
+ * reverb in over half a second from the crossing, while the previous one
+ * fades out; the blend does not depend on the distance to the edge. Without
+ * ALC_EXT_EFX the zones are tracked but nothing is heard.
+ *
+ * @param preset The reverb of the zone.
+ * @return The id of the zone, from 1 up, or -1 if there are too many zones.
+ */
+int AudioManager::AddReverbZone(const EFXEAXREVERBPROPERTIES& preset) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    return reverb_.AddZone(preset);
+}
+
+/**
+ * @brief Assigns a rectangle of cells to a reverb zone; zone 0 removes the reverb.
+ *
+ * @param zone The id returned by AddReverbZone, or 0.
+ * @param x The first column.
+ * @param y The first row.
+ * @param width The number of columns.
+ * @param height The number of rows.
+ */
+void AudioManager::SetReverbZoneRect(int zone, int x, int y, int width, int height) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    reverb_.FillRect(zone, x, y, width, height);
+}
+
+/**
+ * @brief Assigns the cells set in a mask to a reverb zone; zone 0 removes the reverb.
+ *
+ * @param zone The id returned by AddReverbZone, or 0.
+ * @param mask One byte per cell, row by row, nonzero for the cells to assign.
+ */
+void AudioManager::SetReverbZoneMask(int zone, const unsigned char* mask) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    reverb_.FillMask(zone, mask);
+}
+
+/**
+ * @brief Returns the reverb zone the listener is in, 0 for none.
+ */
+int AudioManager::GetReverbZone() {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    return reverb_.ZoneAt(listenerX_, listenerY_);
+}
+
+/**
+ * @brief Sets the walls that occlude 2D sounds.
+ *
+ * Every wall on the straight line between the listener and a sound lowers
+ * the sound and muffles it with a low-pass filter (the muffling needs
+ * ALC_EXT_EFX). A sound is only retraced when it or the listener moves to
+ * another cell, so standing still costs nothing however many sounds there are.
+ *
+ * @param cells One value per cell, row by row; nonzero cells are walls. The
+ *        grid is copied, so call again after changing it. Null removes the grid.
+ * @param width The number of columns.
+ * @param height The number of rows.
+ * @param cellSize The size of a cell in world units.
+ */
+void AudioManager::SetCollisionGrid(const int* cells, int width, int height, float cellSize) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    occlusion_.SetGrid(cells, width, height, cellSize);
+    paths_.SetGrid(cells, width, height, cellSize);
+    emitterGrid_.SetBucketSize(kEmitterBucketCells * (cellSize > 0.0f ? cellSize : 1.0f));
+    for (int i = 0; i < spatialSources_.SlotCount(); i++) {
+        if (!spatialSources_.IsLive(i)) continue;
+        spatialSources_[i].traced = false;
+        spatialSources_[i].walls = 0;
+    }
+}
+
+/**
+ * @brief Chooses how far 2D sounds are from the listener.
+ *
+ * With kPathDistance a sound is attenuated by the distance one would walk to
+ * reach it on the collision grid (see SetCollisionGrid), so in a maze it
+ * comes from around the corners; walls in between still muffle it, but no
+ * longer lower it, as the longer path already does. The walking distances
+ * are flooded from the listener's cell whenever it changes, up to the
+ * largest maxDistance of the registered sounds, and each sound then reads
+ * its own in a single lookup. Sounds farther than that are silent.
+ * Without a collision grid both modes are the same.
+ *
+ * @param mode The propagation mode; kStraightLine by default.
+ */
+void AudioManager::SetPropagation(Propagation mode) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    propagation_ = mode;
+}
+
+/**
+ * @brief Chooses who does the 2D spatialization: this manager or OpenAL.
+ *
+ * kPanned2D is the original model: the gain and a left/right pan are
+ * computed here for a listener facing up the screen. kWorld3D places the
+ * listener (with the direction of SetListenerFacing) and each sound at its
+ * world position instead, with X across and Y down the screen as the ground
+ * plane, and OpenAL's inverse distance clamped model attenuates them: full
+ * volume within 1 world unit, then quieter by each emitter's rolloff (see
+ * SetEmitterRolloff), up to its maxDistance. Sounds still go out of range at
+ * maxDistance, fading over its last tenth; walls still lower and muffle
+ * them, but kPathDistance has no effect. Combine it with SetHrtf for sounds
+ * placed all around a listener on headphones.
+ *
+ * Sounds that are not registered as 2D sounds, like the music, are heard
+ * the same in both modes.
+ *
+ * @param mode The listener mode; kPanned2D by default.
+ */
+void AudioManager::SetListenerMode(ListenerMode mode) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    listenerMode_ = mode;
+    listenerDirty_ = true;
+}
+
+/**
+ * @brief Turns head-related transfer function rendering on or off.
+ *
+ * HRTF filters every sound the way the head and ears do, so on headphones
+ * sounds are heard in front, behind or to the sides instead of merely left
+ * or right. It needs ALC_SOFT_HRTF, and the device may refuse it (e.g. on
+ * speakers); the device is reset, which keeps every source and buffer.
+ *
+ * @param enabled True to ask for HRTF, false to turn it off.
+ * @return True if HRTF is on afterwards.
+ */
+bool AudioManager::SetHrtf(bool enabled) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    if (!resetDevice_) return false;
+
+    const ALCint attributes[] = { ALC_HRTF_SOFT, enabled ? ALC_TRUE : ALC_FALSE,
+        ALC_MAX_AUXILIARY_SENDS, ReverbZones::kSends, 0 };
+    if (!resetDevice_(device_, attributes)) return false;
+
+    ALCint hrtf = ALC_FALSE;
+    alcGetIntegerv(device_, ALC_HRTF_SOFT, 1, &hrtf);
+    return hrtf == ALC_TRUE;
+}
+
+/**
+ * @brief Feeds the voices playing this tick to the duck rules.
+ *
+ * Makes no OpenAL call: activity is read from the voice pool and the
+ * streams, and a changed attenuation reaches the sources through ApplyBuses.
+ *
+ * @param deltaTime The time elapsed since the last update, in seconds.
+ */
+void AudioManager::ApplyDucking(float deltaTime) {
+    if (!buses_.HasDucks()) return;
+
+    for (const auto& voice : voices_) {
+        if (voice.channel >= 0) buses_.MarkActive(channels_[voice.channel].bus);
+        else if (voice.oneShotOf >= 0) buses_.MarkActive(channels_[voice.oneShotOf].bus);
+    }
+    for (const auto& slot : streams_) {
+        if (slot.stream && slot.playing) buses_.MarkActive(channels_[slot.channel].bus);
+    }
+    buses_.UpdateDucks(deltaTime);
+}
+
+/**
+ * @brief Resolves the bus tree and pushes what changed to the sounds heard through it.
+ *
+ * Runs once per tick. Nothing is touched unless a bus setter ran; then only
+ * voices and streams routed to a changed bus are updated, and the shadow
+ * sources drop the gains that end up unchanged.
+ */
+void AudioManager::ApplyBuses() {
+    if (!buses_.Resolve()) return;
+
+    for (auto& voice : voices_) {
+        if (voice.channel >= 0) {
+            const Channel& channel = channels_[voice.channel];
+            if (buses_.GainChanged(channel.bus)) voice.source.SetGain(HeardGain(channel));
+            continue; // Paused channels give their voice up in UpdateVoices
+        }
+        if (voice.oneShotOf < 0) continue;
+
+        int bus = channels_[voice.oneShotOf].bus;
+        if (buses_.GainChanged(bus)) voice.source.SetGain(voice.gain * buses_.Gain(bus));
+        if (buses_.PauseChanged(bus)) ToggleBusPause(voice.source.id, buses_.IsPaused(bus));
+    }
+
+    for (auto& slot : streams_) {
+        if (!slot.stream) continue;
+        const Channel& channel = channels_[slot.channel];
+        if (buses_.GainChanged(channel.bus)) slot.source.SetGain(HeardGain(channel));
+        if (buses_.PauseChanged(channel.bus) && slot.playing) {
+            ToggleBusPause(slot.source.id, buses_.IsPaused(channel.bus));
+        }
+    }
+}
+
+/**
+ * @brief Releases all OpenAL resources and closes the device and context.
+ *
+ * Deletes the voice pool, streams and cached buffers, destroys the context, and closes the device.
+ * This should be called before application exit.
+ */
+void AudioManager::Close() {
+    StopAudioThread();
+
+    // Stop the loader workers; unfinished loads are dropped
+    if (!loadWorkers_.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(loadMutex_);
+            loadQuit_ = true;
+            loadQueue_.clear();
+        }
+        loadWake_.notify_all();
+        for (auto& worker : loadWorkers_) worker.join();
+        loadWorkers_.clear();
+    }
+    loadResults_.clear();
+    pendingStreams_.clear();
+
+    // Stop the stream reader before tearing the streams down
+    if (streamReader_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(streamMutex_);
+            streamReaderQuit_ = true;
+        }
+        streamWake_.notify_one();
+        streamReader_.join();
+    }
+
+    // Streams must give their queued buffers back before anything is deleted
+    for (auto& slot : streams_) {
+        if (!slot.stream) continue;
+        slot.stream->Stop(slot.source.id);
+        AL_CALL(alDeleteSources(1, &slot.source.id));
+    }
+    streams_.clear();
+    fades_.Clear();
+    buses_.Clear();
+
+    // No source events may arrive once the voices are gone
+    if (eventCallback_) {
+        const ALenum types[] = { AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT };
+        AL_CALL(eventControl_(1, types, AL_FALSE));
+        AL_CALL(eventCallback_(nullptr, nullptr));
+        eventControl_ = nullptr;
+        eventCallback_ = nullptr;
+    }
+
+    // Delete the voices, then the cached buffers they referenced
+    for (auto& voice : voices_) {
+        AL_CALL(alSourceStop(voice.source.id));
+        AL_CALL(alDeleteSources(1, &voice.source.id));
+    }
+    for (auto& entry : bufferCache_) {
+        if (entry.second.buffer != 0) AL_CALL(alDeleteBuffers(1, &entry.second.buffer));
+    }
+    voices_.clear();
+    sourceVoices_.clear();
+    reverb_.Close(); // Only once no source sends to the slots
+    occlusion_.Close();
+    channels_.Clear(); // Keeps the generations, so old handles stay stale
+    spatialSources_.Clear();
+    emitterGrid_.Clear();
+    inRange_.clear();
+    bufferCache_.clear(); // Only safe once the static buffers are gone
+    banks_.clear();
+    bufferDataStatic_ = nullptr;
+    floatFormats_ = false;
+    deferUpdates_ = nullptr;
+    processUpdates_ = nullptr;
+    getInteger64_ = nullptr;
+    resetDevice_ = nullptr;
+    playAtTime_ = nullptr;
+    getSourcei64_ = nullptr;
+    capture_.Close();
+    renderSamples_ = nullptr;
+    renderOutput_.clear();
+    stats_ = AudioStats();
+
+    // Destroy context and close device
+    if (context_) {
+        alcMakeContextCurrent(nullptr);
+        alcDestroyContext(context_);
+        context_ = nullptr;
+    }
+    if (device_) {
+        alcCloseDevice(device_);
+        device_ = nullptr;
+    }
+}
+
+/**
+ * @brief Sets the volume (gain) for a specific sound.
+ *
+ * The gain value is linear, where 1.0 is default volume. A sound that becomes
+ * inaudible gives its voice up on the next Update and plays on virtually.
+ *
+ * @param sound The handle of the sound.
+ * @param gain The desired volume level (e.g., 0.0 for mute, 1.0 for full volume).
+ */
+void AudioManager::SetVolume(SoundHandle sound, float gain) {
+    Command command;
+    command.type = Command::kSetVolume;
+    command.sound = sound;
+    command.value = gain;
+    if (Post(command)) return;
+
+    int index = SlotOf(sound);
+    if (index < 0) return;
+    fades_.Cancel(index);
+    SetChannelGain(index, gain);
+}
+
+/**
+ * @brief Checks if a sound is currently playing.
+ *
+ * Virtual sounds (playing without a voice, see Play) count as playing, and
+ * so does a sound whose Play is waiting for its buffer. The answer reflects
+ * the last Update and costs no OpenAL call; to act as soon as a sound ends,
+ * prefer SetEndCallback over calling this every frame.
+ *
+ * @param sound The handle of the sound.
+ * @return True if the sound is playing, false otherwise (or if the handle is stale).
+ */
+bool AudioManager::IsPlaying(SoundHandle sound) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    int index = SlotOf(sound);
+    if (index < 0) return false;
+
+    // A stream waiting on its reader is still considered playing
+    const Channel& channel = channels_[index];
+    if (channel.stream >= 0) return streams_[channel.stream].playing;
+    return channel.playing;
+}
+
+/**
+ * @brief Registers an existing audio source as a 2D spatial sound.
+ *
+ * This stores the initial position and maximum audible distance for the source,
+ * allowing its volume and panning to be calculated based on the listener's position.
+ *
+ * @param sound The handle of the sound (returned by LoadWav).
+ * @param x The initial X-coordinate of the sound source in world units.
+ * @param y The initial Y-coordinate of the sound source in world units.
+ * @param maxDistance The distance at which the sound is completely attenuated.
+ * @return The handle used to move the emitter, or a null handle if the sound handle is stale.
+ */
+EmitterHandle AudioManager::Register2DSound(SoundHandle sound, float x, float y, float maxDistance) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    int index = SlotOf(sound);
+    if (index < 0) return EmitterHandle();
+
+    SoundSource2D emitter;
+    emitter.channel = index;
+    emitter.x = x;
+    emitter.y = y;
+    emitter.maxDistance = maxDistance;
+    EmitterHandle handle = spatialSources_.Insert(emitter);
+    emitterGrid_.Insert(static_cast<int>(handle.index), x, y, maxDistance);
+    inRange_.push_back(static_cast<int>(handle.index)); // So the next update silences it if it is out of range
+    return handle;
+}
+
+/**
+ * @brief Sets how fast a 2D sound fades with distance in kWorld3D (see SetListenerMode).
+ *
+ * @param emitter The handle returned by Register2DSound. Stale handles are ignored.
+ * @param rolloff The AL_ROLLOFF_FACTOR: 1 halves the gain at 2 world units,
+ *        lower values carry the sound farther. 1 by default.
+ */
+void AudioManager::SetEmitterRolloff(EmitterHandle emitter, float rolloff) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    if (SoundSource2D* s = spatialSources_.Get(emitter)) s->rolloff = rolloff;
+}
+
+/**
+ * @brief Removes a registered 2D spatial sound. The sound itself stays loaded.
+ *
+ * @param emitter The handle returned by Register2DSound.
+ */
+void AudioManager::Unregister2DSound(EmitterHandle emitter) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    int index = spatialSources_.Find(emitter);
+    if (index >= 0) RemoveEmitter(index);
+}
+
+/**
+ * @brief Removes an emitter from the spatial sounds and from the emitter index.
+ *
+ * @param emitter A live slot of spatialSources_.
+ */
+void AudioManager::RemoveEmitter(int emitter) {
+    emitterGrid_.Remove(emitter);
+    auto it = std::find(inRange_.begin(), inRange_.end(), emitter);
+    if (it != inRange_.end()) {
+        *it = inRange_.back();
+        inRange_.pop_back();
+    }
+    spatialSources_.RemoveAt(emitter);
+}
+
+/**
+ * @brief Updates the world position of a registered 2D spatial sound source.
+ *
+ * @param emitter The handle returned by Register2DSound. Stale handles are ignored.
+ * @param x The new X-coordinate.
+ * @param y The new Y-coordinate.
+ */
+void AudioManager::SetSourcePosition(EmitterHandle emitter, float x, float y) {
+    Command command;
+    command.type = Command::kSetPosition;
+    command.emitter = emitter;
+    command.x = x;
+    command.y = y;
+    if (Post(command)) return;
+
+    if (SoundSource2D* s = spatialSources_.Get(emitter)) {
+        s->x = x;
+        s->y = y;
+        emitterGrid_.Move(static_cast<int>(emitter.index), x, y);
+    }
+}
+
+/**
+ * @brief Computes the distance gain and left/right panning of a 2D sound.
+ *
+ * **Note on Listener Orientation:** In this 2D system, the listener is assumed
+ * to be facing in the negative X direction with 'right' being in the positive
+ * X direction (rightX = 1.0f), which simplifies the calculation of panning
+ * based on the sound's relative X-position to the listener.
+ *
+ * @param dx The X offset from the listener to the sound.
+ * @param dy The Y offset from the listener to the sound.
+ * @param maxDistance The distance at which the sound is completely attenuated.
+ * @param gain Receives the distance attenuation in [0, 1].
+ * @param panning Receives the lateral position in [-1, 1].
+ */
+static void Attenuate2D(float dx, float dy, float maxDistance, float* gain, float* panning) {
+    // Listener 'right' direction (fixed for 2D top-down view)
+    float rightX = 1.0f;
+    float rightY = 0.0f;
+
+    // 1. Calculate Distance and Attenuation (Volume)
+    float distance = std::sqrt(dx * dx + dy * dy);
+
+    // Calculate gain: 1.0 at distance 0, 0.0 at maxDistance, clamped between 0 and 1
+    *gain = std::clamp(1.0f - (distance / maxDistance), 0.0f, 1.0f);
+
+    // 2. Calculate Panning (Position)
+    // Dot product of (sound-listener vector) and listener's 'right' vector
+    float dotRight = dx * rightX + dy * rightY;
+
+    // Normalize dot product to [-1.0, 1.0] for position/panning
+    *panning = std::clamp(dotRight / maxDistance, -1.0f, 1.0f);
+}
+
+/**
+ * @brief Sets the direct-path low-pass of a source unless it already has that value.
+ */
+void AudioManager::SetSourceLowpass(ShadowSource& source, float gainHF) {
+    if (source.lowpass == gainHF) return;
+    occlusion_.ApplyLowpass(source.id, gainHF);
+    source.lowpass = gainHF;
+}
+
+/**
+ * @brief Puts a source where its channel is heard: panned, or in the world (see SetListenerMode).
+ */
+void AudioManager::PlaceSource(ShadowSource& source, const Channel& channel) {
+    if (channel.placed) source.SetWorldPosition(channel.x, channel.y, channel.maxDistance, channel.rolloff);
+    else source.SetPanning(channel.panning);
+}
+
+/**
+ * @brief Moves the OpenAL listener to the 2D listener position and facing.
+ *
+ * AL_ORIENTATION is the facing on the ground plane followed by an up vector
+ * out of the screen, which puts the listener's right on the screen's right
+ * when facing up.
+ */
+void AudioManager::PlaceListener() {
+    AL_CALL(alListener3f(AL_POSITION, listenerX_, 0.0f, listenerY_));
+    const ALfloat orientation[] = { facingX_, 0.0f, facingY_, 0.0f, 1.0f, 0.0f };
+    AL_CALL(alListenerfv(AL_ORIENTATION, orientation));
+    listenerDirty_ = false;
+}
+
+/**
+ * @brief Counts the walls between the listener and every 2D sound in range that needs it.
+ *
+ * An emitter keeps its count until it or the listener changes cell (or the
+ * grid is replaced). The emitters to retrace are gathered first and traced
+ * in one tight pass afterwards; emitters out of range are not visited, and
+ * are traced again once they come back (see LeaveRange).
+ */
+void AudioManager::TraceOcclusion(float listenerX, float listenerY) {
+    int cellX = occlusion_.CellOf(listenerX);
+    int cellY = occlusion_.CellOf(listenerY);
+    bool listenerMoved = cellX != listenerCellX_ || cellY != listenerCellY_;
+    listenerCellX_ = cellX;
+    listenerCellY_ = cellY;
+
+    traceQueue_.clear();
+    for (int i : inRange_) {
+        SoundSource2D& s = spatialSources_[i];
+        int x = occlusion_.CellOf(s.x), y = occlusion_.CellOf(s.y);
+        if (s.traced && !listenerMoved && x == s.cellX && y == s.cellY) continue;
+        s.traced = true;
+        s.cellX = x;
+        s.cellY = y;
+        traceQueue_.push_back(i);
+    }
+
+    for (int i : traceQueue_) {
+        SoundSource2D& s = spatialSources_[i];
+        s.walls = occlusion_.Trace(cellX, cellY, s.cellX, s.cellY);
+    }
+}
+
+/**
+ * @brief Silences an emitter the listener just walked out of range of.
+ *
+ * Its sound gives its voice back right away instead of playing on at zero
+ * gain, and goes on virtually, keeping its position, so it resumes at the
+ * right offset once the listener is back in range (see UpdateVoices).
+ *
+ * @param emitter A live slot of spatialSources_.
+ */
+void AudioManager::LeaveRange(int emitter) {
+    SoundSource2D& s = spatialSources_[emitter];
+    s.traced = false;
+    SetChannelGain(s.channel, 0.0f);
+    if (channels_[s.channel].voice >= 0) ReleaseVoice(s.channel, true);
+}
+
+/**
+ * @brief Applies the propagation and listener modes to the straight-line gain of a 2D sound.
+ *
+ * In kWorld3D the distance is left to OpenAL, so only the walls and the fade
+ * at the edge of the range remain.
+ *
+ * @param x The X-coordinate of the sound.
+ * @param y The Y-coordinate of the sound.
+ * @param maxDistance The distance at which the sound is completely attenuated.
+ * @param distanceGain The straight-line attenuation (see Attenuate2D).
+ * @param walls The walls between the sound and the listener (see TraceOcclusion).
+ * @return The gain of the sound.
+ */
+float AudioManager::PropagatedGain(float x, float y, float maxDistance, float distanceGain, int walls) const {
+    if (listenerMode_ == kWorld3D) return std::min(distanceGain / kEdgeFade, 1.0f) * Occlusion::Gain(walls);
+    if (propagation_ != kPathDistance || !paths_.HasGrid()) return distanceGain * Occlusion::Gain(walls);
+
+    float walked = paths_.DistanceAt(x, y);
+    if (walked < 0.0f) return 0.0f;
+    return std::clamp(1.0f - walked / maxDistance, 0.0f, 1.0f);
+}
+
+/**
+ * @brief Updates the gain and panning for all registered 2D spatial sounds.
+ *
+ * Calculates distance-based attenuation (volume) and left/right panning
+ * (position) relative to the listener's position and orientation (see
+ * Attenuate2D). With a collision grid, the walls in between lower and
+ * muffle each sound (see SetCollisionGrid), or the distance is walked around
+ * them (see SetPropagation). The position is also remembered for PlayOneShot.
+ *
+ * Only the emitters around the listener are visited, found through a grid
+ * index of their positions and attenuated together by SpatialKernel; the
+ * ones that just went out of range are virtualized (see LeaveRange), so the
+ * cost follows the number of sounds around the listener rather than the
+ * number registered.
+ *
+ * @param listenerX The listener's X-coordinate.
+ * @param listenerY The listener's Y-coordinate.
+ */
+void AudioManager::UpdateSpatial2D(float listenerX, float listenerY) {
+    Command command;
+    command.type = Command::kSetListener;
+    command.x = listenerX;
+    command.y = listenerY;
+    if (Post(command)) return;
+    StatsTimer timer(&stats_.spatialMicros, &stats_.spatialMaxMicros);
+
+    if (listenerX != listenerX_ || listenerY != listenerY_) listenerDirty_ = true;
+    listenerX_ = listenerX;
+    listenerY_ = listenerY;
+    BeginBatch();
+    if (listenerMode_ == kWorld3D && listenerDirty_) PlaceListener();
+
+    // Emitters heard from here; the ones of the last update not among them just left
+    spatialTick_++;
+    emitterGrid_.Gather(listenerX, listenerY, &nearby_);
+    SpatialKernel::Attenuate(nearby_, listenerX, listenerY);
+    heard_.clear();
+    for (int k = 0; k < nearby_.Size(); k++) {
+        if (nearby_.gain[k] <= 0.0f) continue;
+        spatialSources_[nearby_.id[k]].seen = spatialTick_;
+        heard_.push_back(nearby_.id[k]);
+    }
+    for (int i : inRange_) {
+        if (spatialSources_[i].seen != spatialTick_) LeaveRange(i);
+    }
+    inRange_.swap(heard_);
+
+    if (occlusion_.HasGrid()) TraceOcclusion(listenerX, listenerY);
+    if (propagation_ == kPathDistance) paths_.Update(listenerX, listenerY, emitterGrid_.MaxRadius());
+
+    for (int k = 0; k < nearby_.Size(); k++) {
+        float d = nearby_.gain[k], panning = nearby_.pan[k];
+        if (d <= 0.0f) continue;
+        const SoundSource2D& s = spatialSources_[nearby_.id[k]];
+
+        // Set OpenAL Source Properties (only while the sound holds a source)
+        // AL_POSITION takes (x, y, z) in listener space. For 2D panning, we use X as lateral position.
+        Channel& channel = channels_[s.channel];
+        channel.panning = panning;
+        channel.placed = listenerMode_ == kWorld3D;
+        channel.x = s.x;
+        channel.y = s.y;
+        channel.maxDistance = s.maxDistance;
+        channel.rolloff = s.rolloff;
+        channel.lowpass = Occlusion::GainHF(s.walls);
+        SetChannelGain(s.channel, PropagatedGain(s.x, s.y, s.maxDistance, d, s.walls));
+        if (ShadowSource* source = SourceOf(channel)) {
+            PlaceSource(*source, channel);
+            SetSourceLowpass(*source, channel.lowpass);
+        }
+    }
+
+    EndBatch();
+}
+
+/**
+ * @brief Sets the direction the listener faces, used in kWorld3D (see SetListenerMode).
+ *
+ * @param facingX The X component of the direction on screen.
+ * @param facingY The Y component; (0, -1), up the screen, by default.
+ */
+void AudioManager::SetListenerFacing(float facingX, float facingY) {
+    Command command;
+    command.type = Command::kSetFacing;
+    command.x = facingX;
+    command.y = facingY;
+    if (Post(command)) return;
+
+    if (facingX == 0.0f && facingY == 0.0f) return; // No direction: keep the last one
+    facingX_ = facingX;
+    facingY_ = facingY;
+    listenerDirty_ = true;
+}
+
+/**
+ * @brief Plays a sound once at a 2D position on a pooled voice, fire-and-forget.
+ *
+ * Unlike Play, every call is a separate playback, so overlapping one-shots of
+ * the same sound (e.g. footsteps) do not cut each other off, and no buffer is
+ * duplicated. The voice goes back to the pool by itself when the sound ends.
+ * One-shots compete for voices like any other sound (see Play) but are never
+ * virtualized: if no voice can be won, or the sound is out of range, nothing
+ * plays. The position is taken relative to the last UpdateSpatial2D listener
+ * and fixed for the life of the one-shot, and so is the wall occlusion; in
+ * kWorld3D the one-shot is placed in the world with a rolloff of 1.
+ *
+ * @param sound A loaded (not streamed) sound.
+ * @param x The X-coordinate of the sound in world units.
+ * @param y The Y-coordinate of the sound in world units.
+ * @param pitchRange Random pitch variation: the pitch is picked in [1 - range, 1 + range].
+ * @param gainRange Random gain variation: the gain is picked in [1 - range, 1].
+ * @param maxDistance The distance at which the sound is completely attenuated.
+ * @param priority Voice priority; higher values are stolen last.
+ * @return The handle of the playback, or a null handle if nothing was played or
+ *         the call was queued for the audio thread (see StartAudioThread).
+ */
+VoiceHandle AudioManager::PlayOneShot(SoundHandle sound, float x, float y, float pitchRange, float gainRange,
+    float maxDistance, int priority) {
+    Command command;
+    command.type = Command::kPlayOneShot;
+    command.sound = sound;
+    command.x = x;
+    command.y = y;
+    command.pitchRange = pitchRange;
+    command.gainRange = gainRange;
+    command.maxDistance = maxDistance;
+    command.priority = priority;
+    if (Post(command)) return VoiceHandle();
+
+    int index = SlotOf(sound);
+    if (index < 0) return VoiceHandle();
+    const Channel& channel = channels_[index];
+    if (channel.loading || channel.stream >= 0) return VoiceHandle();
+
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    float pitch = std::max(1.0f + pitchRange * (2.0f * unit(random_) - 1.0f), 0.05f);
+    float gain = 1.0f - gainRange * unit(random_);
+
+    float distanceGain, panning;
+    Attenuate2D(x - listenerX_, y - listenerY_, maxDistance, &distanceGain, &panning);
+    int walls = 0;
+    if (distanceGain > 0.0f && occlusion_.HasGrid()) {
+        walls = occlusion_.Trace(occlusion_.CellOf(listenerX_), occlusion_.CellOf(listenerY_),
+            occlusion_.CellOf(x), occlusion_.CellOf(y));
+    }
+    if (propagation_ == kPathDistance) paths_.Update(listenerX_, listenerY_, maxDistance); // Widens the field if needed
+    gain *= PropagatedGain(x, y, maxDistance, distanceGain, walls);
+    float heardGain = gain * buses_.Gain(channel.bus);
+    if (heardGain <= kAudibleGain) return VoiceHandle();
+
+    int v = AcquireVoice(priority, heardGain);
+    if (v < 0) return VoiceHandle();
+
+    Voice& voice = voices_[v];
+    AL_CALL(alSourcei(voice.source.id, AL_BUFFER, static_cast<ALint>(channel.buffer)));
+    voice.source.SetLooping(false);
+    voice.source.SetGain(heardGain);
+    voice.source.SetPitch(pitch);
+    if (listenerMode_ == kWorld3D) voice.source.SetWorldPosition(x, y, maxDistance, 1.0f);
+    else voice.source.SetPanning(panning);
+    SetSourceLowpass(voice.source, Occlusion::GainHF(walls));
+    AL_CALL(alSourcePlay(voice.source.id));
+
+    voice.oneShotOf = index;
+    voice.priority = priority;
+    voice.gain = gain;
+
+    VoiceHandle handle;
+    handle.index = static_cast<uint32_t>(v);
+    handle.generation = voice.generation;
+    return handle;
+}
+
+/**
+ * @brief Resolves a voice handle to its pool index.
+ *
+ * @param voice The handle of a playback.
+ * @return The voice index, or -1 if the handle is null or the playback is over.
+ */
+int AudioManager::VoiceOf(VoiceHandle voice) const {
+    if (voice.index >= voices_.size()) return -1;
+    const Voice& v = voices_[voice.index];
+    if (v.generation != voice.generation || (v.channel < 0 && v.oneShotOf < 0)) return -1;
+    return static_cast<int>(voice.index);
+}
+
+/**
+ * @brief Checks if a one-shot started by PlayOneShot is still playing.
+ *
+ * Like IsPlaying, the answer reflects the last Update.
+ *
+ * @param voice The handle returned by PlayOneShot.
+ * @return True while the playback lasts; false once it ended, was stopped or stolen.
+ */
+bool AudioManager::IsVoicePlaying(VoiceHandle voice) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    return VoiceOf(voice) >= 0;
+}
+
+/**
+ * @brief Stops a one-shot early and returns its voice to the pool.
+ *
+ * @param voice The handle returned by PlayOneShot. Stale handles are ignored.
+ */
+void AudioManager::StopVoice(VoiceHandle voice) {
+    Command command;
+    command.type = Command::kStopVoice;
+    command.voice = voice;
+    if (Post(command)) return;
+
+    int v = VoiceOf(voice);
+    if (v < 0) return;
+    if (voices_[v].channel >= 0) StopSource(voices_[v].channel);
+    else FreeVoice(v);
+}
+
+/**
+ * @brief Moves mixing updates onto a dedicated audio thread ticking at a fixed rate.
+ *
+ * From then on the real-time methods (Play, PlayAt, QueueAfter, Stop,
+ * SetVolume, FadeTo, Pause, Resume, SetBus, SetBusVolume, SetBusMuted,
+ * SetBusPaused, Crossfade, PlayStream, SetSourcePosition, UpdateSpatial2D,
+ * PlayOneShot, StopVoice) do
+ * not touch OpenAL: they push a command on a lock-free queue and return, and
+ * the audio thread applies the commands in order at the start of its next
+ * tick, then runs Update with its own clock. Fades therefore advance at the
+ * tick rate whatever the frame rate, and a slow frame no longer delays them.
+ * Calling Update from the game thread becomes a no-op.
+ *
+ * Loading reads files on the calling thread and leaves the OpenAL uploads to
+ * the tick (see LoadWav). Loading, unloading and the query methods (IsPlaying,
+ * IsLoaded, ...) only take a lock shared with the audio thread's tick to read
+ * or publish state; queries see the effect of a queued command once the audio
+ * thread applied it. All calls must come from a single thread.
+ *
+ * Does nothing in loopback mode, where Render drives the mix (see InitLoopback).
+ *
+ * @param tickRate The number of ticks per second.
+ */
+void AudioManager::StartAudioThread(int tickRate) {
+    if (audioThreaded_ || tickRate <= 0 || renderSamples_) return;
+    audioThreadQuit_ = false;
+    audioThreaded_ = true;
+    audioThread_ = std::thread(&AudioManager::AudioThreadLoop, this, tickRate);
+}
+
+/**
+ * @brief Stops the audio thread and goes back to game-thread updates.
+ *
+ * Commands still queued are executed before returning, so none is lost.
+ */
+void AudioManager::StopAudioThread() {
+    if (!audioThreaded_) return;
+    audioThreadQuit_ = true;
+    audioThread_.join();
+    audioThreaded_ = false;
+
+    Command command;
+    while (commands_.Pop(&command)) Execute(command);
+}
+
+/**
+ * @brief Hands a real-time call over to the audio thread, if it is running.
+ *
+ * Calls made on the audio thread itself (while it executes a command) run
+ * directly. If the queue is full the caller yields until the audio thread
+ * catches up, so commands are never dropped or reordered.
+ *
+ * @param command The call to defer.
+ * @return True if the command was queued, false if the caller must run the call now.
+ */
+bool AudioManager::Post(const Command& command) {
+    if (!audioThreaded_ || tlsAudioThreadOwner == this) return false;
+    while (!commands_.Push(command)) std::this_thread::yield();
+    return true;
+}
+
+/**
+ * @brief Runs a queued call on the audio thread.
+ *
+ * @param command The call to run.
+ */
+void AudioManager::Execute(const Command& command) {
+    switch (command.type) {
+    case Command::kPlay:        Play(command.sound, command.loop, command.priority); break;
+    case Command::kStop:        Stop(command.sound); break;
+    case Command::kSetVolume:   SetVolume(command.sound, command.value); break;
+    case Command::kCrossfade:   Crossfade(command.sound, command.target, command.duration, command.curve); break;
+    case Command::kPlayStream:  PlayStream(command.sound, command.loop); break;
+    case Command::kSetPosition: SetSourcePosition(command.emitter, command.x, command.y); break;
+    case Command::kSetListener: UpdateSpatial2D(command.x, command.y); break;
+    case Command::kSetFacing:   SetListenerFacing(command.x, command.y); break;
+    case Command::kPlayOneShot:
+        PlayOneShot(command.sound, command.x, command.y, command.pitchRange, command.gainRange,
+            command.maxDistance, command.priority);
+        break;
+    case Command::kStopVoice:   StopVoice(command.voice); break;
+    case Command::kPlayAt:      PlayAt(command.sound, command.time, command.loop, command.priority); break;
+    case Command::kQueueAfter:  QueueAfter(command.sound, command.target, command.loop); break;
+    case Command::kFadeTo:
+        FadeTo(command.sound, command.value, command.duration, command.curve, command.action);
+        break;
+    case Command::kPause:       Pause(command.sound); break;
+    case Command::kResume:      Resume(command.sound); break;
+    case Command::kSetBus:      SetBus(command.sound, command.bus); break;
+    case Command::kSetBusVolume: SetBusVolume(command.bus, command.value); break;
+    case Command::kSetBusMuted: SetBusMuted(command.bus, command.enabled); break;
+    case Command::kSetBusPaused: SetBusPaused(command.bus, command.enabled); break;
+    }
+}
+
+/**
+ * @brief Body of the audio thread.
+ *
+ * Each tick attaches the finished loads, applies the queued commands and
+ * runs Update with the measured time step. Ticks missed because of a stall
+ * are skipped, not replayed.
+ *
+ * @param tickRate The number of ticks per second.
+ */
+void AudioManager::AudioThreadLoop(int tickRate) {
+    using Clock = std::chrono::steady_clock;
+    tlsAudioThreadOwner = this;
+
+    const Clock::duration period =
+        std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / tickRate));
+    Clock::time_point last = Clock::now();
+    Clock::time_point next = last + period;
+
+    while (!audioThreadQuit_) {
+        std::this_thread::sleep_until(next);
+        Clock::time_point now = Clock::now();
+        next += period;
+        if (next < now) next = now + period;
+
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        BeginBatch(); // The commands and the update of a tick reach the mixer together
+        ProcessLoads(); // Sounds loaded before a command was posted are ready for it
+        Command command;
+        while (commands_.Pop(&command)) Execute(command);
+        Update(std::chrono::duration<float>(now - last).count());
+        EndBatch();
+        last = now;
+    }
+
+    tlsAudioThreadOwner = nullptr;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file soundBank.cpp
+ * @brief Runtime access to packed sound banks.
+ *
+ * A bank is opened with one mapping and validated once; lookups are a hash
+ * probe and return pointers straight into the mapping, ready for alBufferData.
+ */
+
+#include <soundBank.h>
+#include <cstring>
+
+/**
+ * @brief Constructs a closed bank.
+ */
+SoundBank::SoundBank()
+    : header_(), slots_(nullptr), entries_(nullptr), names_(nullptr) {
+}
+
+/**
+ * @brief Computes the 64-bit FNV-1a hash used by the bank index.
+ *
+ * @param name The sound name.
+ * @return The hash of the name.
+ */
+uint64_t SoundBank::HashName(const std::string& name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : name) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * @brief Returns true if [offset, offset + length) lies within a file of the given size.
+ *
+ * Written so that no sum can wrap around, whatever the file claims.
+ */
+static bool InRange(uint64_t offset, uint64_t length, uint64_t size) {
+    return offset <= size && length <= size - offset;
+}
+
+/**
+ * @brief Returns the size of a sample frame in one of the core OpenAL formats BankBuilder writes, or 0.
+ */
+static uint32_t FrameBytes(int32_t format) {
+    switch (format) {
+    case AL_FORMAT_MONO8:    return 1;
+    case AL_FORMAT_MONO16:   return 2;
+    case AL_FORMAT_STEREO8:  return 2;
+    case AL_FORMAT_STEREO16: return 4;
+    default:                 return 0;
+    }
+}
+
+/**
+ * @brief Maps a bank file and validates its header, index and entries.
+ *
+ * @param filename The path to the bank file.
+ * @return True if the bank is usable, false otherwise.
+ */
+bool SoundBank::Open(const std::string& filename) {
+    if (!file_.Open(filename)) return false;
+
+    const unsigned char* base = file_.Data();
+    size_t size = file_.Size();
+    if (size < sizeof(BankHeader)) return false;
+
+    std::memcpy(&header_, base, sizeof(BankHeader));
+    if (std::memcmp(header_.magic, kBankMagic, 4) != 0 || header_.version != kBankVersion) return false;
+
+    // The slot count must be a power of two, larger than the entry count
+    uint32_t slots = header_.slotCount;
+    if (slots == 0 || (slots & (slots - 1)) != 0 || slots <= header_.entryCount) return false;
+
+    if (!InRange(header_.slotsOffset, uint64_t(slots) * sizeof(uint32_t), size)) return false;
+    if (!InRange(header_.entriesOffset, uint64_t(header_.entryCount) * sizeof(BankEntry), size)) return false;
+    if (!InRange(header_.namesOffset, header_.namesSize, size)) return false;
+    if (header_.slotsOffset % alignof(uint32_t) != 0 || header_.entriesOffset % alignof(BankEntry) != 0) return false;
+
+    slots_ = reinterpret_cast<const uint32_t*>(base + header_.slotsOffset);
+    entries_ = reinterpret_cast<const BankEntry*>(base + header_.entriesOffset);
+    names_ = reinterpret_cast<const char*>(base + header_.namesOffset);
+
+    // Validate once here so lookups never need bounds checks
+    for (uint32_t i = 0; i < header_.entryCount; i++) {
+        const BankEntry& e = entries_[i];
+        if (uint64_t(e.nameOffset) + e.nameLength > header_.namesSize) return false;
+        if (!InRange(e.dataOffset, e.dataSize, size) || e.dataOffset % kBankAlignment != 0) return false;
+        // alBufferData would reject these on every load, so refuse the bank now
+        uint32_t frameBytes = FrameBytes(e.format);
+        if (frameBytes == 0 || e.sampleRate <= 0 || e.dataSize == 0 || e.dataSize % frameBytes != 0) return false;
+    }
+
+    // Slot values may repeat, so the slot count alone does not prove a free
+    // slot; without one a probe for a missing name would never end
+    uint32_t freeSlots = 0;
+    for (uint32_t i = 0; i < slots; i++) {
+        if (slots_[i] > header_.entryCount) return false;
+        if (slots_[i] == 0) freeSlots++;
+    }
+    if (freeSlots == 0) return false;
+
+    return true;
+}
+
+/**
+ * @brief Looks a sound up by name.
+ *
+ * @param name The sound name (its path inside the packed directory, without extension).
+ * @param sound Receives the location and format of the samples.
+ * @return True if the bank contains the sound.
+ */
+bool SoundBank::Find(const std::string& name, BankSound* sound) const {
+    if (!slots_ || !sound) return false;
+
+    uint64_t hash = HashName(name);
+    uint32_t mask = header_.slotCount - 1;
+
+    for (uint32_t slot = static_cast<uint32_t>(hash) & mask;; slot = (slot + 1) & mask) {
+        uint32_t value = slots_[slot];
+        if (value == 0) return false;
+
+        const BankEntry& e = entries_[value - 1];
+        if (e.nameHash == hash && e.nameLength == name.size() &&
+            std::memcmp(names_ + e.nameOffset, name.data(), name.size()) == 0) {
+            sound->samples = file_.Data() + e.dataOffset;
+            sound->dataSize = static_cast<size_t>(e.dataSize);
+            sound->format = e.format;
+            sound->sampleRate = e.sampleRate;
+            return true;
+        }
+    }
+}
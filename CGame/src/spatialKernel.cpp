@@ -0,0 +1,171 @@
+/**
+ * @file spatialKernel.cpp
+ * @brief Scalar, SSE and AVX2 versions of the 2D attenuation, chosen at runtime.
+ *
+ * The vector versions are compiled for their instruction set function by
+ * function (GCC and Clang need the target attribute for that, MSVC does not),
+ * so the rest of the program keeps the baseline flags and still runs on CPUs
+ * without AVX2.
+ */
+
+#include <spatialKernel.h>
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SPATIAL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SPATIAL_TARGET_AVX2
+#else
+#define SPATIAL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+/**
+ * @brief Drops every emitter, keeping the memory.
+ */
+void EmitterArrays::Clear() {
+    id.clear();
+    x.clear();
+    y.clear();
+    maxDistance.clear();
+    gain.clear();
+    pan.clear();
+}
+
+/**
+ * @brief Appends an emitter; its gain and pan are 0 until the next Attenuate.
+ */
+void EmitterArrays::Push(int emitter, float emitterX, float emitterY, float range) {
+    id.push_back(emitter);
+    x.push_back(emitterX);
+    y.push_back(emitterY);
+    maxDistance.push_back(range);
+    gain.push_back(0.0f);
+    pan.push_back(0.0f);
+}
+
+/**
+ * @brief Attenuates emitters [begin, end) one at a time.
+ */
+static void AttenuateScalar(EmitterArrays& e, float listenerX, float listenerY, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        float dx = e.x[i] - listenerX;
+        float dy = e.y[i] - listenerY;
+        float distance = std::sqrt(dx * dx + dy * dy);
+        e.gain[i] = std::clamp(1.0f - distance / e.maxDistance[i], 0.0f, 1.0f);
+        e.pan[i] = std::clamp(dx / e.maxDistance[i], -1.0f, 1.0f);
+    }
+}
+
+#ifdef SPATIAL_X86
+/**
+ * @brief Attenuates emitters 4 at a time, and the remainder one at a time.
+ */
+static void AttenuateSse(EmitterArrays& e, float listenerX, float listenerY) {
+    const int count = e.Size();
+    const int whole = count & ~3;
+    const __m128 lx = _mm_set1_ps(listenerX), ly = _mm_set1_ps(listenerY);
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), minusOne = _mm_set1_ps(-1.0f);
+
+    for (int i = 0; i < whole; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_load_ps(&e.x[i]), lx);
+        __m128 dy = _mm_sub_ps(_mm_load_ps(&e.y[i]), ly);
+        __m128 range = _mm_load_ps(&e.maxDistance[i]);
+        __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+        __m128 gain = _mm_sub_ps(one, _mm_div_ps(distance, range));
+        _mm_store_ps(&e.gain[i], _mm_min_ps(_mm_max_ps(gain, zero), one));
+        _mm_store_ps(&e.pan[i], _mm_min_ps(_mm_max_ps(_mm_div_ps(dx, range), minusOne), one));
+    }
+    AttenuateScalar(e, listenerX, listenerY, whole, count);
+}
+
+/**
+ * @brief Attenuates emitters 8 at a time, and the remainder one at a time.
+ */
+SPATIAL_TARGET_AVX2
+static void AttenuateAvx2(EmitterArrays& e, float listenerX, float listenerY) {
+    const int count = e.Size();
+    const int whole = count & ~7;
+    const __m256 lx = _mm256_set1_ps(listenerX), ly = _mm256_set1_ps(listenerY);
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), minusOne = _mm256_set1_ps(-1.0f);
+
+    for (int i = 0; i < whole; i += 8) {
+        __m256 dx = _mm256_sub_ps(_mm256_load_ps(&e.x[i]), lx);
+        __m256 dy = _mm256_sub_ps(_mm256_load_ps(&e.y[i]), ly);
+        __m256 range = _mm256_load_ps(&e.maxDistance[i]);
+        __m256 distance = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+        __m256 gain = _mm256_sub_ps(one, _mm256_div_ps(distance, range));
+        _mm256_store_ps(&e.gain[i], _mm256_min_ps(_mm256_max_ps(gain, zero), one));
+        _mm256_store_ps(&e.pan[i], _mm256_min_ps(_mm256_max_ps(_mm256_div_ps(dx, range), minusOne), one));
+    }
+    _mm256_zeroupper(); // Avoids the AVX to SSE transition penalty in the scalar tail
+    AttenuateScalar(e, listenerX, listenerY, whole, count);
+}
+#endif
+
+/**
+ * @brief Returns the widest level the CPU and the operating system support.
+ */
+SpatialKernel::Level SpatialKernel::Detect() {
+#ifdef SPATIAL_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6; // OSXSAVE, then XMM and YMM state
+    bool avx = (info[2] & (1 << 28)) != 0;
+    __cpuidex(info, 7, 0);
+    if (osSavesYmm && avx && (info[1] & (1 << 5)) != 0) return kAvx2;
+#else
+    if (__builtin_cpu_supports("avx2")) return kAvx2;
+#endif
+    return kSse;
+#else
+    return kScalar;
+#endif
+}
+
+/**
+ * @brief Returns the name of a level, for reports.
+ */
+const char* SpatialKernel::Name(Level level) {
+    switch (level) {
+    case kSse:  return "sse";
+    case kAvx2: return "avx2";
+    default:    return "scalar";
+    }
+}
+
+/**
+ * @brief Computes the gain and pan of every emitter at the best level available.
+ *
+ * @param emitters The emitters; gain and pan are overwritten.
+ * @param listenerX The listener's X-coordinate.
+ * @param listenerY The listener's Y-coordinate.
+ */
+void SpatialKernel::Attenuate(EmitterArrays& emitters, float listenerX, float listenerY) {
+    static const Level level = Detect();
+    Attenuate(emitters, listenerX, listenerY, level);
+}
+
+/**
+ * @brief Computes the gain and pan of every emitter at a given level.
+ *
+ * A level the build cannot run (a vector level off x86) falls back to kScalar;
+ * the caller must not ask for one the CPU lacks (see Detect).
+ */
+void SpatialKernel::Attenuate(EmitterArrays& emitters, float listenerX, float listenerY, Level level) {
+#ifdef SPATIAL_X86
+    if (level == kAvx2) {
+        AttenuateAvx2(emitters, listenerX, listenerY);
+        return;
+    }
+    if (level == kSse) {
+        AttenuateSse(emitters, listenerX, listenerY);
+        return;
+    }
+#endif
+    AttenuateScalar(emitters, listenerX, listenerY, 0, emitters.Size());
+}
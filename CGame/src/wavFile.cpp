@@ -0,0 +1,386 @@
+/**
+ * @file wavFile.cpp
+ * @brief Memory-mapped file access, in-place RIFF/WAVE parsing and WAV output.
+ *
+ * The parser walks the chunk headers of a WAV image that is already in memory
+ * (normally a MappedFile) and reports where the PCM payload lives, so callers
+ * can hand that pointer straight to OpenAL without an intermediate copy.
+ */
+
+#include <wavFile.h>
+#include <cstring>
+#include <cstdint>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Constructs an empty (unmapped) file.
+ */
+MappedFile::MappedFile()
+    : data_(nullptr), size_(0)
+#ifdef _WIN32
+    , file_(nullptr), mapping_(nullptr)
+#endif
+{
+}
+
+/**
+ * @brief Destructor. Unmaps the file if it is still open.
+ */
+MappedFile::~MappedFile() {
+    Close();
+}
+
+/**
+ * @brief Move constructor. Takes ownership of the other object's mapping.
+ */
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : MappedFile() {
+    *this = std::move(other);
+}
+
+/**
+ * @brief Move assignment. Releases the current mapping and takes the other one.
+ */
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+#ifdef _WIN32
+        std::swap(file_, other.file_);
+        std::swap(mapping_, other.mapping_);
+#endif
+    }
+    return *this;
+}
+
+/**
+ * @brief Maps a whole file read-only into the address space.
+ *
+ * Empty files cannot be mapped and are reported as failures.
+ *
+ * @param filename The path to the file.
+ * @return True if the file is mapped, false otherwise.
+ */
+bool MappedFile::Open(const std::string& filename) {
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    file_ = file;
+    mapping_ = mapping;
+    data_ = static_cast<const unsigned char*>(view);
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps its own reference to the file
+    if (view == MAP_FAILED) return false;
+
+    data_ = static_cast<const unsigned char*>(view);
+    size_ = static_cast<size_t>(st.st_size);
+#endif
+    return true;
+}
+
+/**
+ * @brief Unmaps the file. Safe to call on an unmapped object.
+ */
+void MappedFile::Close() {
+#ifdef _WIN32
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_) CloseHandle(file_);
+    mapping_ = nullptr;
+    file_ = nullptr;
+#else
+    if (data_) munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+/**
+ * @brief Touches every page of the mapping so it is read from disk now.
+ *
+ * Mapped pages are only loaded when first accessed. Loader threads call this
+ * so the disk reads happen on them instead of on whoever consumes the data.
+ */
+void MappedFile::Prefault() const {
+    Prefault(data_, size_);
+}
+
+/**
+ * @brief Touches every page of part of a mapping so it is read from disk now.
+ *
+ * @param data The start of the range, inside a mapping.
+ * @param size The size of the range in bytes.
+ */
+void MappedFile::Prefault(const unsigned char* data, size_t size) {
+    const size_t pageSize = 4096;
+    volatile unsigned char sink = 0;
+    for (size_t i = 0; i < size; i += pageSize) sink ^= data[i];
+    if (size > 0) sink ^= data[size - 1]; // An unaligned range reaches into one more page
+    (void)sink;
+}
+
+/**
+ * @brief Reads a little-endian 16-bit value from an unaligned address.
+ */
+static uint16_t ReadU16(const unsigned char* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+/**
+ * @brief Reads a little-endian 32-bit value from an unaligned address.
+ */
+static uint32_t ReadU32(const unsigned char* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+        (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+/** @brief "fmt " format tags. */
+static const uint16_t kFormatPcm = 1;
+static const uint16_t kFormatFloat = 3;
+static const uint16_t kFormatExtensible = 0xFFFE;
+
+/**
+ * @brief Parses a RIFF/WAVE image in place.
+ *
+ * Walks the chunk headers to find "fmt " and "data" without copying anything.
+ * Unknown chunks are skipped (including their RIFF pad byte), and a "data"
+ * chunk that claims more bytes than the image holds is clamped to what is
+ * actually there.
+ *
+ * Mono and stereo files of 8, 16, 24 or 32-bit integers or 32-bit floats are
+ * accepted, with a plain or a WAVE_FORMAT_EXTENSIBLE "fmt " chunk. Only 8 and
+ * 16-bit PCM get a core OpenAL format; floats get the AL_EXT_FLOAT32 one, and
+ * 24 and 32-bit integers none at all, so those need SampleConvert.
+ *
+ * @param bytes Pointer to the start of the WAV image.
+ * @param size Size of the image in bytes.
+ * @param info Receives the format description and the location of the samples.
+ * @return True if both chunks were found, the encoding is one of the above and
+ *         there is at least one sample frame at a positive rate.
+ */
+bool ParseWav(const unsigned char* bytes, size_t size, WavInfo* info) {
+    if (!bytes || !info || size < 12) return false;
+
+    // Check RIFF and WAVE header
+    if (std::memcmp(bytes, "RIFF", 4) != 0 || std::memcmp(bytes + 8, "WAVE", 4) != 0) return false;
+
+    bool fmtFound = false;
+    bool dataFound = false;
+    uint16_t formatTag = 0;
+    size_t offset = 12;
+
+    // Iterate through chunks to find "fmt " and "data"
+    while (offset + 8 <= size && (!fmtFound || !dataFound)) {
+        const unsigned char* chunkId = bytes + offset;
+        size_t chunkSize = ReadU32(bytes + offset + 4);
+        const unsigned char* payload = bytes + offset + 8;
+        size_t available = size - (offset + 8);
+
+        if (std::memcmp(chunkId, "fmt ", 4) == 0) {
+            if (chunkSize < 16 || available < 16) return false;
+            fmtFound = true;
+            info->audioFormat = static_cast<short>(ReadU16(payload));
+            info->numChannels = static_cast<short>(ReadU16(payload + 2));
+            info->sampleRate = static_cast<int>(ReadU32(payload + 4));
+            // ByteRate and BlockAlign are skipped
+            info->bitsPerSample = static_cast<short>(ReadU16(payload + 14));
+
+            // WAVE_FORMAT_EXTENSIBLE keeps the real tag in the first 2 bytes of its SubFormat GUID
+            formatTag = ReadU16(payload);
+            if (formatTag == kFormatExtensible) {
+                if (chunkSize < 40 || available < 40) return false;
+                formatTag = ReadU16(payload + 24);
+            }
+        }
+        else if (std::memcmp(chunkId, "data", 4) == 0) {
+            dataFound = true;
+            info->samples = payload;
+            info->dataSize = chunkSize < available ? chunkSize : available;
+        }
+
+        // Chunks are word aligned: odd sizes are followed by a pad byte
+        size_t advance = 8 + chunkSize + (chunkSize & 1);
+        if (advance > size - offset) break;
+        offset += advance;
+    }
+
+    if (!fmtFound || !dataFound) return false;
+
+    if (info->numChannels != 1 && info->numChannels != 2) return false;
+    bool stereo = info->numChannels == 2;
+
+    // Determine the encoding and the OpenAL format
+    info->encoding = kWavUnsupported;
+    if (formatTag == kFormatPcm) {
+        switch (info->bitsPerSample) {
+        case 8:  info->encoding = kWavPcm8; break;
+        case 16: info->encoding = kWavPcm16; break;
+        case 24: info->encoding = kWavPcm24; break;
+        case 32: info->encoding = kWavPcm32; break;
+        }
+    }
+    else if (formatTag == kFormatFloat && info->bitsPerSample == 32) {
+        info->encoding = kWavFloat32;
+    }
+
+    switch (info->encoding) {
+    case kWavPcm8:    info->format = stereo ? AL_FORMAT_STEREO8 : AL_FORMAT_MONO8; break;
+    case kWavPcm16:   info->format = stereo ? AL_FORMAT_STEREO16 : AL_FORMAT_MONO16; break;
+    case kWavFloat32: info->format = stereo ? AL_FORMAT_STEREO_FLOAT32 : AL_FORMAT_MONO_FLOAT32; break;
+    case kWavUnsupported: return false;
+    default:          info->format = 0; break;
+    }
+
+    // A truncated data chunk is cut back to whole sample frames
+    size_t frameBytes = static_cast<size_t>(info->numChannels) * (info->bitsPerSample / 8);
+    info->dataSize -= info->dataSize % frameBytes;
+    if (info->sampleRate <= 0 || info->dataSize == 0) return false;
+
+    return true;
+}
+
+/**
+ * @brief Stores a little-endian 16-bit value at an unaligned address.
+ */
+static void WriteU16(unsigned char* p, uint16_t value) {
+    p[0] = static_cast<unsigned char>(value);
+    p[1] = static_cast<unsigned char>(value >> 8);
+}
+
+/**
+ * @brief Stores a little-endian 32-bit value at an unaligned address.
+ */
+static void WriteU32(unsigned char* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+/** @brief Size of the canonical header: RIFF, a 16-byte "fmt " chunk and the "data" chunk header. */
+static const size_t kWavHeaderSize = 44;
+
+/**
+ * @brief Constructs a writer with no file open.
+ */
+WavWriter::WavWriter() : dataSize_(0) {
+}
+
+/**
+ * @brief Destructor. Finishes the file if it is still open.
+ */
+WavWriter::~WavWriter() {
+    Close();
+}
+
+/**
+ * @brief Creates (or truncates) a WAV file and writes its header.
+ *
+ * @param filename The path of the file.
+ * @param channels The number of interleaved channels of the samples.
+ * @param sampleRate The sample rate in Hz.
+ * @return True if the file was created.
+ */
+bool WavWriter::Open(const std::string& filename, int channels, int sampleRate) {
+    Close();
+    file_.open(filename, std::ios::binary | std::ios::trunc);
+    if (!file_) return false;
+
+    unsigned char header[kWavHeaderSize] = {};
+    std::memcpy(header, "RIFF", 4);
+    std::memcpy(header + 8, "WAVE", 4);
+    std::memcpy(header + 12, "fmt ", 4);
+    WriteU32(header + 16, 16);
+    WriteU16(header + 20, 1); // PCM
+    WriteU16(header + 22, static_cast<uint16_t>(channels));
+    WriteU32(header + 24, static_cast<uint32_t>(sampleRate));
+    WriteU32(header + 28, static_cast<uint32_t>(sampleRate * channels * 2));
+    WriteU16(header + 32, static_cast<uint16_t>(channels * 2));
+    WriteU16(header + 34, 16);
+    std::memcpy(header + 36, "data", 4);
+    file_.write(reinterpret_cast<const char*>(header), kWavHeaderSize);
+    dataSize_ = 0;
+    return static_cast<bool>(file_);
+}
+
+/**
+ * @brief Appends interleaved samples to the "data" chunk.
+ *
+ * @param samples The samples, in the channel count given to Open.
+ * @param count The number of samples (not frames).
+ */
+void WavWriter::Write(const int16_t* samples, size_t count) {
+    if (!file_.is_open() || count == 0) return;
+    // The samples are written as they are in memory, which is little-endian on every target
+    file_.write(reinterpret_cast<const char*>(samples), static_cast<std::streamsize>(count * sizeof(int16_t)));
+    dataSize_ += static_cast<uint32_t>(count * sizeof(int16_t));
+}
+
+/**
+ * @brief Fills in the chunk sizes and closes the file.
+ *
+ * @return True if everything was written; false if no file was open or a write failed.
+ */
+bool WavWriter::Close() {
+    if (!file_.is_open()) return false;
+
+    unsigned char size[4];
+    WriteU32(size, static_cast<uint32_t>(kWavHeaderSize - 8) + dataSize_);
+    file_.seekp(4);
+    file_.write(reinterpret_cast<const char*>(size), 4);
+    WriteU32(size, dataSize_);
+    file_.seekp(40);
+    file_.write(reinterpret_cast<const char*>(size), 4);
+
+    bool written = static_cast<bool>(file_);
+    file_.close();
+    dataSize_ = 0;
+    return written;
+}
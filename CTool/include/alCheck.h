@@ -0,0 +1,47 @@
+#pragma once
+#include <audioStats.h>
+
+/**
+ * @brief How much OpenAL error checking AL_CALL does.
+ *
+ * alGetError has to wait for the context, so checking every call is only
+ * affordable while debugging:
+ *  - 2 (debug): every call is checked, and an error is reported with the
+ *    file, line and text of the call that raised it;
+ *  - 1 (profile): one call in 64 is checked, so errors still show up, near
+ *    where they happened, at a fraction of the cost;
+ *  - 0 (release): nothing is checked and AL_CALL is just the call.
+ *
+ * Defaults to 2, or to 0 when NDEBUG is defined; the CMake builds pick 1 for
+ * RelWithDebInfo.
+ */
+#ifndef AL_CHECK_LEVEL
+#ifdef NDEBUG
+#define AL_CHECK_LEVEL 0
+#else
+#define AL_CHECK_LEVEL 2
+#endif
+#endif
+
+void AlCheck(const char* file, int line, const char* call);
+void AlCheckSampled(const char* file, int line, const char* call);
+
+#ifdef AUDIO_STATS
+#define AL_COUNT_CALL() AudioStats::CountAlCall()
+#else
+#define AL_COUNT_CALL() ((void)0)
+#endif
+
+#if AL_CHECK_LEVEL >= 2
+#define AL_CHECK_CALL(text) AlCheck(__FILE__, __LINE__, text)
+#elif AL_CHECK_LEVEL == 1
+#define AL_CHECK_CALL(text) AlCheckSampled(__FILE__, __LINE__, text)
+#else
+#define AL_CHECK_CALL(text) ((void)0)
+#endif
+
+/** @brief Makes an OpenAL call, counting it (see AudioStats) and checking it (see AL_CHECK_LEVEL). */
+#define AL_CALL(call) (AL_COUNT_CALL(), (call), AL_CHECK_CALL(#call))
+
+/** @brief Makes an OpenAL call whose error the caller reads itself with alGetError; it is only counted. */
+#define AL_PROBE(call) (AL_COUNT_CALL(), (call))
@@ -0,0 +1,73 @@
+#pragma once
+#include <../deps/OpenAL/include/AL/al.h>
+#include <wavFile.h>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A WAV file played through a small ring of queued OpenAL buffers.
+ *
+ * A background reader fills the staging blocks (FillBlocks) and the thread
+ * that owns the OpenAL context uploads them into the buffer ring (Service).
+ * Only kBufferCount * kBlockSize bytes of PCM are ever resident, on each side,
+ * regardless of the length of the track, plus a copy of its first block so
+ * that Start never reads the file.
+ */
+class AudioStream {
+public:
+    static const int kBufferCount = 4;
+    static const size_t kBlockSize = 32 * 1024;
+
+    AudioStream();
+    ~AudioStream();
+
+    bool Open(const std::string& filename, bool floatFormats);
+
+    void Start(ALuint source, bool loop);
+    void Stop(ALuint source);
+    void Close();
+    int Service(ALuint source);
+    void FillBlocks();
+
+    bool IsActive();
+    bool IsLooping();
+
+private:
+    struct Block {
+        std::vector<char> data;
+        size_t size = 0;
+        bool ready = false; /**< Filled by the reader and waiting to be uploaded. */
+    };
+
+    bool NextRange(size_t* offset, size_t* count);
+    size_t ReadSamples(size_t offset, size_t count, std::vector<char>& out);
+    int UploadBlocks(ALuint source);
+
+    std::ifstream file_;    /**< Only read by the thread calling FillBlocks, without mutex_. */
+    std::vector<char> raw_; /**< The samples of one block as read, when convert_ is set (reader only). */
+    std::vector<char> spare_; /**< The block being read, swapped into the ring once filled (reader only). */
+    std::vector<char> head_;  /**< The first block of the track, as uploaded (see Start). */
+    size_t headRead_;    /**< Bytes of the "data" chunk that head_ holds. */
+
+    std::mutex mutex_; /**< Guards everything below except buffers_ and idle_. */
+    ALenum format_;      /**< Format of the uploaded blocks, after any conversion. */
+    WavEncoding encoding_;
+    bool convert_;       /**< The samples go through SampleConvert on their way into the blocks. */
+    int sampleRate_;
+    size_t blockBytes_;  /**< Bytes read per block: kBlockSize rounded down to whole sample frames. */
+    size_t dataOffset_;  /**< File offset of the "data" chunk payload. */
+    size_t dataSize_;
+    size_t cursor_;      /**< Next byte to read, relative to dataOffset_. */
+    Block blocks_[kBufferCount];
+    int fillBlock_;      /**< Next block the reader writes. */
+    int uploadBlock_;    /**< Next block Service uploads. */
+    bool loop_;
+    bool active_;
+    bool eof_;
+    unsigned generation_; /**< Bumped by Start, so a block read before it is dropped. */
+
+    ALuint buffers_[kBufferCount];
+    std::vector<ALuint> idle_; /**< OpenAL buffers waiting for data. */
+};
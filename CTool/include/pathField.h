@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Walking distance from the listener to every cell around it, going around walls.
+ *
+ * The field is a flood fill over a collision grid (nonzero = wall) from the
+ * listener's cell, moving to the 8 neighbours of each cell without cutting
+ * wall corners. Diagonal steps cost 7/5 of a straight one, which keeps the
+ * error against the true distance under 2%, and the small integer costs let
+ * a ring of buckets stand in for the priority queue of Dijkstra's algorithm.
+ *
+ * The fill stops at a radius, so its cost depends on the area the sounds can
+ * be heard in, not on the size of the map; cells are marked with the number
+ * of the fill that reached them, so the grid is never cleared either.
+ */
+class PathField {
+public:
+    PathField();
+
+    void SetGrid(const int* cells, int width, int height, float cellSize);
+    bool Update(float listenerX, float listenerY, float radius);
+    float DistanceAt(float x, float y) const;
+
+    bool HasGrid() const { return !walls_.empty(); }
+
+private:
+    static const uint32_t kStraight = 5; /**< Cost of a step to a side neighbour. */
+    static const uint32_t kDiagonal = 7; /**< Cost of a step to a corner neighbour. */
+    static const int kBuckets = kDiagonal + 1; /**< Enough for every pending cost to have its own bucket. */
+
+    void Flood(int originX, int originY, uint32_t limit);
+    bool IsOpen(int x, int y) const;
+    uint32_t CostAt(int x, int y) const;
+
+    std::vector<uint8_t> walls_;  /**< 1 per wall cell, row-major. */
+    std::vector<uint32_t> cost_;  /**< Distance in steps of kStraight, valid where stamp_ matches. */
+    std::vector<uint32_t> stamp_; /**< Fill that last reached each cell. */
+    std::vector<int> buckets_[kBuckets]; /**< Cells waiting to be expanded, by cost modulo kBuckets. */
+    uint32_t generation_;
+    int width_, height_;
+    float cellSize_;
+    int originX_, originY_; /**< Cell of the last fill. */
+    float radius_;          /**< Radius of the last fill, negative if it is out of date. */
+};
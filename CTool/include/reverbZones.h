@@ -0,0 +1,71 @@
+#pragma once
+#include <../deps/OpenAL/include/AL/al.h>
+#include <../deps/OpenAL/include/AL/alc.h>
+#include <../deps/OpenAL/include/AL/efx.h>
+#include <../deps/OpenAL/include/AL/efx-presets.h>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief EFX reverb chosen by the region of the map the listener stands in.
+ *
+ * The map is covered by a grid of cells, each holding the id of its reverb
+ * zone (0 = no reverb), so finding the listener's zone is a single lookup
+ * however big the map is. Two auxiliary effect slots are used in turns: when
+ * the listener walks into another zone, its preset is loaded into the idle
+ * slot and the two slots crossfade, so the reverb does not switch abruptly.
+ * Every source sends to both slots.
+ *
+ * The blend runs in time, over half a second from the moment the listener
+ * crosses the edge; how far the listener stands from the edge plays no part.
+ * Zones are arbitrary sets of cells, and a blend by distance would need the
+ * distance to the nearest cell of every other zone around the listener.
+ *
+ * Without ALC_EXT_EFX the grid still works (see ZoneAt), but nothing is heard.
+ */
+class ReverbZones {
+public:
+    ReverbZones();
+
+    static const ALCint kSends = 2; /**< Auxiliary sends each source needs (see Init). */
+
+    bool Init(ALCdevice* device);
+    void Close();
+    void Attach(ALuint source) const;
+
+    void SetGrid(int width, int height, float cellSize);
+    int AddZone(const EFXEAXREVERBPROPERTIES& preset);
+    void FillRect(int zone, int x, int y, int width, int height);
+    void FillMask(int zone, const unsigned char* mask);
+    int ZoneAt(float x, float y) const;
+    void Update(float listenerX, float listenerY, float deltaTime);
+
+    bool IsAvailable() const { return slots_[0] != 0; }
+    /** @brief Zone of the slot fading in; lags the listener's while a blend waits for a silent slot. */
+    int CurrentZone() const { return slotZone_[active_]; }
+
+private:
+    void LoadPreset(ALuint effect, const EFXEAXREVERBPROPERTIES& preset) const;
+
+    LPALGENEFFECTS genEffects_;
+    LPALDELETEEFFECTS deleteEffects_;
+    LPALEFFECTI effecti_;
+    LPALEFFECTF effectf_;
+    LPALEFFECTFV effectfv_;
+    LPALGENAUXILIARYEFFECTSLOTS genSlots_;
+    LPALDELETEAUXILIARYEFFECTSLOTS deleteSlots_;
+    LPALAUXILIARYEFFECTSLOTI sloti_;
+    LPALAUXILIARYEFFECTSLOTF slotf_;
+    bool eaxReverb_; /**< AL_EFFECT_EAXREVERB is supported; otherwise the standard reverb is used. */
+
+    ALuint effects_[kSends];
+    ALuint slots_[kSends];   /**< 0 while EFX is unavailable. */
+    int slotZone_[kSends];   /**< Zone whose preset each slot holds, 0 for none. */
+    float slotGain_[kSends]; /**< Last gain submitted to each slot. */
+    int active_;             /**< Slot of the listener's zone; the other one fades out. */
+
+    std::vector<EFXEAXREVERBPROPERTIES> presets_; /**< Preset of each zone, at index id - 1. */
+    std::vector<uint8_t> grid_; /**< Zone id of each cell, row-major. */
+    int width_, height_;
+    float cellSize_;
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include <../deps/OpenAL/include/AL/al.h>
+#include <../deps/OpenAL/include/AL/alext.h>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * The mapping is released when the object is closed or destroyed. It can be
+ * moved (e.g. into a container) but not copied.
+ */
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& filename);
+    void Close();
+    void Prefault() const;
+    static void Prefault(const unsigned char* data, size_t size);
+
+    const unsigned char* Data() const { return data_; }
+    size_t Size() const { return size_; }
+    bool IsOpen() const { return data_ != nullptr; }
+
+private:
+    const unsigned char* data_;
+    size_t size_;
+#ifdef _WIN32
+    void* file_;    /**< Win32 file HANDLE. */
+    void* mapping_; /**< Win32 file mapping HANDLE. */
+#endif
+};
+
+/**
+ * @brief Sample encoding of a WAV file.
+ */
+enum WavEncoding : uint8_t {
+    kWavUnsupported,
+    kWavPcm8,    /**< Unsigned 8-bit integers. */
+    kWavPcm16,
+    kWavPcm24,   /**< Packed 3-byte integers. */
+    kWavPcm32,
+    kWavFloat32, /**< IEEE floats in [-1, 1]. */
+};
+
+/**
+ * @brief Format description and sample location of a parsed WAV file.
+ *
+ * `samples` points into the memory that was parsed; nothing is copied.
+ */
+struct WavInfo {
+    short audioFormat = 0;                  /**< Format tag as written; WAVE_FORMAT_EXTENSIBLE is not resolved. */
+    short numChannels = 0;
+    short bitsPerSample = 0;
+    int sampleRate = 0;
+    WavEncoding encoding = kWavUnsupported;
+    ALenum format = 0;                      /**< Matching OpenAL buffer format; 0 if OpenAL has none (see SampleConvert). */
+    const unsigned char* samples = nullptr; /**< Start of the "data" chunk payload. */
+    size_t dataSize = 0;                    /**< Size in bytes of the "data" chunk payload. */
+};
+
+bool ParseWav(const unsigned char* bytes, size_t size, WavInfo* info);
+
+/**
+ * @brief Writes 16-bit PCM samples to a WAV file as they come.
+ *
+ * The header is written up front with empty sizes, which Close fills in, so
+ * a file whose writer was never closed is still there but reads as empty.
+ */
+class WavWriter {
+public:
+    WavWriter();
+    ~WavWriter();
+
+    bool Open(const std::string& filename, int channels, int sampleRate);
+    void Write(const int16_t* samples, size_t count);
+    bool Close();
+
+    bool IsOpen() const { return file_.is_open(); }
+
+private:
+    std::ofstream file_;
+    uint32_t dataSize_; /**< Bytes of samples written so far. */
+};
@@ -0,0 +1,67 @@
+/**
+ * @file alCheck.cpp
+ * @brief OpenAL error reporting behind AL_CALL.
+ */
+
+#include <alCheck.h>
+#include <../deps/OpenAL/include/AL/al.h>
+#include <iostream>
+
+/** @brief Calls between two checks at AL_CHECK_LEVEL 1. */
+static const unsigned kSampleInterval = 64;
+
+/**
+ * @brief Returns the name of an OpenAL error code.
+ */
+static const char* ErrorName(ALenum error) {
+    switch (error) {
+    case AL_INVALID_NAME:      return "AL_INVALID_NAME";
+    case AL_INVALID_ENUM:      return "AL_INVALID_ENUM";
+    case AL_INVALID_VALUE:     return "AL_INVALID_VALUE";
+    case AL_INVALID_OPERATION: return "AL_INVALID_OPERATION";
+    case AL_OUT_OF_MEMORY:     return "AL_OUT_OF_MEMORY";
+    default:                   return "Unknown OpenAL error";
+    }
+}
+
+/**
+ * @brief Prints an OpenAL error with the place it was caught.
+ */
+static void Report(ALenum error, const char* file, int line, const char* call, const char* where) {
+    // Only the file name; __FILE__ may hold the whole build path
+    const char* name = file;
+    for (const char* c = file; *c; c++) {
+        if (*c == '/' || *c == '\\') name = c + 1;
+    }
+    std::cerr << "OpenAL error " << ErrorName(error) << " " << where << " " << name << ":" << line << ": " << call << '\n';
+}
+
+/**
+ * @brief Reports the OpenAL error raised by the call just made, if any (AL_CHECK_LEVEL 2).
+ *
+ * @param file The source file of the call.
+ * @param line The line of the call.
+ * @param call The text of the call.
+ */
+void AlCheck(const char* file, int line, const char* call) {
+    ALenum error = alGetError();
+    if (error != AL_NO_ERROR) Report(error, file, line, call, "at");
+}
+
+/**
+ * @brief Checks one call in kSampleInterval made on this thread (AL_CHECK_LEVEL 1).
+ *
+ * OpenAL keeps the first error until it is read, so an error raised by any
+ * call since the last check is caught here; the place reported is the
+ * sampled call, not necessarily the one that failed.
+ *
+ * @param file The source file of the call.
+ * @param line The line of the call.
+ * @param call The text of the call.
+ */
+void AlCheckSampled(const char* file, int line, const char* call) {
+    static thread_local unsigned calls = 0;
+    if (++calls % kSampleInterval != 0) return;
+    ALenum error = alGetError();
+    if (error != AL_NO_ERROR) Report(error, file, line, call, "before");
+}
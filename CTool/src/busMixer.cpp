@@ -0,0 +1,215 @@
+/**
+ * @file busMixer.cpp
+ * @brief Mixer bus tree with effective values resolved in one flat pass.
+ */
+
+#include <busMixer.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/**
+ * @brief Creates the mixer with its master bus.
+ */
+BusMixer::BusMixer() : dirty_(false) {
+    Clear();
+}
+
+/**
+ * @brief Adds a bus under an existing one, at full volume.
+ *
+ * @param name A name not used by any other bus.
+ * @param parent The bus this one is mixed into.
+ * @return The id of the new bus, or -1 if the name is taken or the parent does not exist.
+ */
+int BusMixer::Create(const std::string& name, int parent) {
+    if (!IsValid(parent) || Find(name) >= 0) return -1;
+
+    name_.push_back(name);
+    parent_.push_back(parent);
+    volume_.push_back(1.0f);
+    duck_.push_back(1.0f);
+    flags_.push_back(0);
+    // Valid right away, so sounds routed before the next Resolve get the right gain
+    gain_.push_back(gain_[parent]);
+    state_.push_back(state_[parent]);
+    changed_.push_back(0);
+    active_.push_back(0);
+    nextDuck_.push_back(1.0f);
+    return Count() - 1;
+}
+
+/**
+ * @brief Returns the id of a bus by name, or -1 if there is none.
+ */
+int BusMixer::Find(const std::string& name) const {
+    for (int bus = 0; bus < Count(); bus++) {
+        if (name_[bus] == name) return bus;
+    }
+    return -1;
+}
+
+/**
+ * @brief Sets the volume of a bus; it scales every bus and sound below it.
+ *
+ * @param bus A valid bus id.
+ * @param gain The linear gain.
+ */
+void BusMixer::SetVolume(int bus, float gain) {
+    if (volume_[bus] == gain) return;
+    volume_[bus] = gain;
+    dirty_ = true;
+}
+
+/**
+ * @brief Mutes or unmutes a bus, keeping its volume.
+ *
+ * @param bus A valid bus id.
+ * @param muted True to silence the bus and everything below it.
+ */
+void BusMixer::SetMuted(int bus, bool muted) {
+    uint8_t flags = muted ? flags_[bus] | kMuted : flags_[bus] & ~kMuted;
+    if (flags_[bus] == flags) return;
+    flags_[bus] = flags;
+    dirty_ = true;
+}
+
+/**
+ * @brief Pauses or resumes a bus and everything below it.
+ *
+ * @param bus A valid bus id.
+ * @param paused True to pause.
+ */
+void BusMixer::SetPaused(int bus, bool paused) {
+    uint8_t flags = paused ? flags_[bus] | kPaused : flags_[bus] & ~kPaused;
+    if (flags_[bus] == flags) return;
+    flags_[bus] = flags;
+    dirty_ = true;
+}
+
+/**
+ * @brief Adds a rule that lowers a bus while another one is active.
+ *
+ * The trigger is active while any voice routed to it, or to a bus below it,
+ * is playing. The attenuation then goes down to the depth over the attack
+ * time, and back to 0 dB over the release time once the trigger goes quiet;
+ * both move in decibels, so they sound even. Several rules on one bus add up.
+ *
+ * @param bus The bus to lower.
+ * @param trigger The bus whose activity lowers it.
+ * @param depthDb The attenuation in dB; the sign is ignored (-8 and 8 both duck by 8 dB).
+ * @param attack Seconds to reach the full depth.
+ * @param release Seconds to come back to 0 dB.
+ * @return The id of the rule, or -1 if a bus does not exist.
+ */
+int BusMixer::AddDuck(int bus, int trigger, float depthDb, float attack, float release) {
+    if (!IsValid(bus) || !IsValid(trigger)) return -1;
+
+    Duck duck;
+    duck.bus = bus;
+    duck.trigger = trigger;
+    duck.depth = -std::fabs(depthDb);
+    duck.attackRate = attack > 0.0f ? -duck.depth / attack : std::numeric_limits<float>::max();
+    duck.releaseRate = release > 0.0f ? -duck.depth / release : std::numeric_limits<float>::max();
+    ducks_.push_back(duck);
+    return static_cast<int>(ducks_.size()) - 1;
+}
+
+/**
+ * @brief Removes a duck rule; its bus comes back on the next UpdateDucks.
+ *
+ * @param duck The id returned by AddDuck.
+ */
+void BusMixer::RemoveDuck(int duck) {
+    if (duck < 0 || duck >= static_cast<int>(ducks_.size())) return;
+    ducks_[duck].trigger = -1;
+    ducks_[duck].level = 0.0f;
+}
+
+/**
+ * @brief Records a playing voice on a bus for this tick's UpdateDucks.
+ *
+ * Voices on a paused bus are not counted.
+ */
+void BusMixer::MarkActive(int bus) {
+    if (!IsPaused(bus)) active_[bus]++;
+}
+
+/**
+ * @brief Moves every duck rule towards its target and sets the bus duck gains.
+ *
+ * Uses and then clears the marks of MarkActive. Buses whose duck gain does
+ * not change are not touched, so settled rules cost no Resolve.
+ *
+ * @param deltaTime The time elapsed since the last call, in seconds.
+ */
+void BusMixer::UpdateDucks(float deltaTime) {
+    // Children come after their parents, so one backwards pass sums activity up the tree
+    for (int bus = Count() - 1; bus > 0; bus--) active_[parent_[bus]] += active_[bus];
+
+    std::fill(nextDuck_.begin(), nextDuck_.end(), 1.0f);
+    for (Duck& rule : ducks_) {
+        if (rule.trigger < 0) continue;
+        float target = active_[rule.trigger] > 0 ? rule.depth : 0.0f;
+        if (rule.level > target) rule.level = std::max(rule.level - rule.attackRate * deltaTime, target);
+        else rule.level = std::min(rule.level + rule.releaseRate * deltaTime, target);
+        nextDuck_[rule.bus] *= std::pow(10.0f, rule.level / 20.0f);
+    }
+
+    for (int bus = 0; bus < Count(); bus++) {
+        if (duck_[bus] != nextDuck_[bus]) {
+            duck_[bus] = nextDuck_[bus];
+            dirty_ = true;
+        }
+        active_[bus] = 0;
+    }
+}
+
+/**
+ * @brief Recomputes the effective gain and state of every bus.
+ *
+ * Does nothing unless a setter ran since the last call. Afterwards
+ * GainChanged and PauseChanged tell which buses actually changed, so only
+ * the sounds routed to those need to be touched.
+ *
+ * @return True if any bus changed.
+ */
+bool BusMixer::Resolve() {
+    if (!dirty_) return false;
+    dirty_ = false;
+
+    bool anyChanged = false;
+    for (int bus = 0; bus < Count(); bus++) {
+        int parent = parent_[bus];
+        float parentGain = parent >= 0 ? gain_[parent] : 1.0f;
+        uint8_t state = flags_[bus] | (parent >= 0 ? state_[parent] : 0);
+        float gain = state != 0 ? 0.0f : volume_[bus] * duck_[bus] * parentGain;
+
+        uint8_t changed = 0;
+        if (gain != gain_[bus]) changed |= kGainChanged;
+        if ((state ^ state_[bus]) & kPaused) changed |= kPauseChanged;
+        gain_[bus] = gain;
+        state_[bus] = state;
+        changed_[bus] = changed;
+        anyChanged |= changed != 0;
+    }
+    return anyChanged;
+}
+
+/**
+ * @brief Removes every bus but the master, and resets the master.
+ */
+void BusMixer::Clear() {
+    name_.assign(1, "master");
+    parent_.assign(1, -1);
+    volume_.assign(1, 1.0f);
+    duck_.assign(1, 1.0f);
+    flags_.assign(1, 0);
+    gain_.assign(1, 1.0f);
+    state_.assign(1, 0);
+    changed_.assign(1, 0);
+    active_.assign(1, 0);
+    nextDuck_.assign(1, 1.0f);
+    ducks_.clear();
+    dirty_ = false;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file emitterGrid.cpp
+ * @brief Hashed uniform grid of emitter circles.
+ */
+
+#include <emitterGrid.h>
+#include <cmath>
+
+/** @brief Default bucket side, in world units. */
+static const float kDefaultBucketSize = 8.0f;
+
+/**
+ * @brief Packs bucket coordinates into one hash key.
+ */
+static inline int64_t PackKey(int64_t x, int64_t y) {
+    return static_cast<int64_t>((static_cast<uint64_t>(x) << 32) ^ static_cast<uint32_t>(y));
+}
+
+/**
+ * @brief Creates an empty index.
+ */
+EmitterGrid::EmitterGrid() : bucketSize_(kDefaultBucketSize) {
+}
+
+/**
+ * @brief Changes the side of the buckets, refiling every circle.
+ *
+ * Buckets about the size of the typical radius work best: smaller ones
+ * make queries visit many buckets, larger ones make them test many circles.
+ *
+ * @param size The side of a bucket in world units.
+ */
+void EmitterGrid::SetBucketSize(float size) {
+    if (size <= 0.0f || size == bucketSize_) return;
+
+    std::vector<Entry> entries;
+    for (auto& bucket : buckets_) entries.insert(entries.end(), bucket.second.begin(), bucket.second.end());
+    buckets_.clear();
+    bucketSize_ = size;
+    for (const Entry& entry : entries) Link(entry);
+}
+
+/**
+ * @brief Files a circle.
+ *
+ * @param id A small non-negative id not in the index, e.g. a slot index.
+ * @param x The X-coordinate of the centre.
+ * @param y The Y-coordinate of the centre.
+ * @param radius The radius of the circle.
+ */
+void EmitterGrid::Insert(int id, float x, float y, float radius) {
+    if (id >= static_cast<int>(location_.size())) location_.resize(id + 1);
+    radii_[radius]++;
+    Link({ id, x, y, radius });
+}
+
+/**
+ * @brief Moves the centre of a filed circle.
+ */
+void EmitterGrid::Move(int id, float x, float y) {
+    Location& location = location_[id];
+    Entry& entry = buckets_[location.key][location.position];
+    entry.x = x;
+    entry.y = y;
+    if (KeyOf(x, y) == location.key) return;
+
+    Entry moved = entry;
+    Unlink(id);
+    Link(moved);
+}
+
+/**
+ * @brief Removes a circle; ids not in the index are ignored.
+ *
+ * Queries shrink back as soon as the largest circle is gone.
+ */
+void EmitterGrid::Remove(int id) {
+    if (id >= static_cast<int>(location_.size()) || location_[id].position < 0) return;
+
+    const Location& location = location_[id];
+    auto radius = radii_.find(buckets_[location.key][location.position].radius);
+    if (--radius->second == 0) radii_.erase(radius);
+    Unlink(id);
+}
+
+/**
+ * @brief Removes every circle.
+ */
+void EmitterGrid::Clear() {
+    buckets_.clear();
+    location_.clear();
+    radii_.clear();
+}
+
+/**
+ * @brief Lists the circles filed in the buckets a point may be heard from.
+ *
+ * The list holds every circle containing the point, plus some near misses:
+ * the exact test is left to SpatialKernel, which does it for free (a gain
+ * above 0) and several circles at a time. When the largest radius spans
+ * more buckets than are filed, the near misses are every circle.
+ *
+ * @param x The X-coordinate of the point.
+ * @param y The Y-coordinate of the point.
+ * @param found Receives the circles, replacing its contents, in no particular order.
+ */
+void EmitterGrid::Gather(float x, float y, EmitterArrays* found) const {
+    found->Clear();
+    if (radii_.empty()) return;
+    float maxRadius = radii_.rbegin()->first;
+
+    int64_t minX = static_cast<int64_t>(std::floor((x - maxRadius) / bucketSize_));
+    int64_t maxX = static_cast<int64_t>(std::floor((x + maxRadius) / bucketSize_));
+    int64_t minY = static_cast<int64_t>(std::floor((y - maxRadius) / bucketSize_));
+    int64_t maxY = static_cast<int64_t>(std::floor((y + maxRadius) / bucketSize_));
+
+    // A square of buckets larger than the filed ones is cheaper to skip: take every circle
+    double span = static_cast<double>(maxX - minX + 1) * static_cast<double>(maxY - minY + 1);
+    if (span > static_cast<double>(buckets_.size())) {
+        for (const auto& bucket : buckets_) {
+            for (const Entry& entry : bucket.second) found->Push(entry.id, entry.x, entry.y, entry.radius);
+        }
+        return;
+    }
+
+    for (int64_t by = minY; by <= maxY; by++) {
+        for (int64_t bx = minX; bx <= maxX; bx++) {
+            auto it = buckets_.find(PackKey(bx, by));
+            if (it == buckets_.end()) continue;
+            for (const Entry& entry : it->second) found->Push(entry.id, entry.x, entry.y, entry.radius);
+        }
+    }
+}
+
+/**
+ * @brief Returns the key of the bucket holding a point.
+ */
+int64_t EmitterGrid::KeyOf(float x, float y) const {
+    return PackKey(static_cast<int64_t>(std::floor(x / bucketSize_)), static_cast<int64_t>(std::floor(y / bucketSize_)));
+}
+
+/**
+ * @brief Adds an entry to the bucket of its centre.
+ */
+void EmitterGrid::Link(const Entry& entry) {
+    int64_t key = KeyOf(entry.x, entry.y);
+    std::vector<Entry>& bucket = buckets_[key];
+    location_[entry.id].key = key;
+    location_[entry.id].position = static_cast<int>(bucket.size());
+    bucket.push_back(entry);
+}
+
+/**
+ * @brief Takes an entry out of its bucket by moving the bucket's last entry into its place.
+ */
+void EmitterGrid::Unlink(int id) {
+    Location& location = location_[id];
+    std::vector<Entry>& bucket = buckets_[location.key];
+    int last = static_cast<int>(bucket.size()) - 1;
+    if (location.position != last) {
+        bucket[location.position] = bucket[last];
+        location_[bucket[last].id].position = location.position;
+    }
+    bucket.pop_back();
+    location.position = -1;
+}
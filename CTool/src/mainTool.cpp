@@ -26,7 +26,7 @@ struct AudioNode {
     int inputPin = -1; /**< Unique identifier for the input attribute pin. */
     int outputPin = -1; /**< Unique identifier for the primary output attribute pin (Output 1). */
     int extraOutputPin = -1; /**< Unique identifier for the secondary output attribute pin (Output 2). */
-    int audioIndex = -1; /**< Index of the loaded audio track in AudioManager (-1 if no audio, e.g., "If Node"). */
+    SoundHandle sound; /**< Handle of the loaded audio track in AudioManager (null if no audio, e.g., "If Node"). */
     bool to_delete = false; /**< Flag indicating if the node should be removed on the next cleanup cycle. */
     bool condition = true; /**< Boolean state used for conditional branching nodes (e.g., "If Node"). */
     std::string name = ""; /**< Display name of the node. */
@@ -53,6 +53,10 @@ int nextLinkId = 1;
 AudioManager audioManager;
 /** @brief ID of the node currently playing audio (-1 if none). */
 int currentPlayingNodeId = -1;
+/** @brief Set by the audio end callback once the current node's audio has finished playing. */
+bool currentNodeEnded = false;
+/** @brief ID of the node queued to start gaplessly after the current one (-1 if none). */
+int queuedNodeId = -1;
 /** @brief Global state flag used for simple branching logic in standard nodes. */
 bool state = true;
 
@@ -67,6 +71,53 @@ AudioNode* FindNodeById(int nodeId) {
     return nullptr;
 }
 
+/**
+ * @brief Finds the node the flow goes to after the given one.
+ *
+ * "If Node"s branch on their own condition, other nodes on the global 'state'.
+ *
+ * @param node The node being left.
+ * @return The ID of the node linked to the selected output pin, or -1 if none.
+ */
+int NextNodeId(const AudioNode& node) {
+    // Determine which output pin to follow based on node type
+    int selectedPin;
+    if (node.name == "If Node") {
+        selectedPin = node.condition ? node.outputPin : node.extraOutputPin;
+    }
+    else {
+        // Use global 'state' for branching if not a dedicated 'If Node'
+        selectedPin = state ? node.outputPin : node.extraOutputPin;
+    }
+
+    // Traverse links to find the input pin connected to the selected output pin
+    for (const auto& l : links) {
+        if (l.startAttr != selectedPin) continue;
+        for (const auto& next : audioNodes) {
+            if (next.inputPin == l.endAttr) return next.id;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Finds the next node with audio, passing through nodes without audio.
+ *
+ * @param node The node being left.
+ * @return The ID of the next node that has audio, or -1 if the flow ends first.
+ */
+int NextAudioNodeId(const AudioNode& node) {
+    const AudioNode* current = &node;
+    // Bounded by the node count so a loop of audio-less nodes cannot hang the tool
+    for (size_t step = 0; step < audioNodes.size(); step++) {
+        AudioNode* next = FindNodeById(NextNodeId(*current));
+        if (!next) return -1;
+        if (!next->sound.IsNull()) return next->id;
+        current = next;
+    }
+    return -1;
+}
+
 /**
  * @brief Checks if a link already exists between two specific attribute pins.
  *
@@ -106,6 +157,12 @@ int main() {
     // Initialize the AudioManager (OpenAL)
     if (!audioManager.Init()) std::cerr << "Failed to init AudioManager\n";
 
+    // Advance the flow as soon as the playing node's audio ends, instead of polling it every frame
+    audioManager.SetEndCallback([](const AudioManager::PlaybackEnded& event) {
+        AudioNode* node = FindNodeById(currentPlayingNodeId);
+        if (node && event.voice.IsNull() && event.sound == node->sound) currentNodeEnded = true;
+        });
+
     // --- Initial Graph Setup ---
 
     // Create the mandatory 'Start' node
@@ -115,11 +172,11 @@ int main() {
     startNode.outputPin = nextId++;
     startNode.extraOutputPin = nextId++;
     startNode.name = "Intro (Start A1)";
-    startNode.audioIndex = audioManager.LoadWav("../assets/A-01.wav");
+    startNode.sound = audioManager.LoadWavAsync("../assets/A-01.wav");
     audioNodes.push_back(startNode);
     ImNodes::SetNodeScreenSpacePos(startNode.id, ImVec2(100, 100));
 
-    // Helper lambda to add audio nodes and set their initial position
+    // Helper lambda to add audio nodes and set their initial position (audio loads in the background)
     auto add = [&](const char* name, const char* path, ImVec2 pos) {
         AudioNode n;
         n.id = nextId++;
@@ -127,7 +184,7 @@ int main() {
         n.outputPin = nextId++;
         n.extraOutputPin = nextId++;
         n.name = name;
-        n.audioIndex = audioManager.LoadWav(path);
+        n.sound = audioManager.LoadWavAsync(path);
         audioNodes.push_back(n);
         ImNodes::SetNodeScreenSpacePos(n.id, pos);
         return n.id;
@@ -179,55 +236,53 @@ int main() {
     link(pin(ba, false, false), pin(a2, true, false));
     link(pin(ba, false, true), pin(b1, true, false));
 
+    // Helper lambda telling nodes with audio from those without, or whose file failed to load
+    auto has_audio = [&](SoundHandle sound) {
+        return !sound.IsNull() && audioManager.GetLoadStatus(sound) != AudioManager::kLoadFailed;
+        };
+
     // --- Main Rendering and Logic Loop ---
+    double lastTime = glfwGetTime();
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
 
+        // Attach finished background loads, advance audio effects and report finished sounds
+        double now = glfwGetTime();
+        audioManager.Update(static_cast<float>(now - lastTime));
+        lastTime = now;
+
         // --- Audio Flow Logic Update ---
         if (currentPlayingNodeId != -1) {
             AudioNode* currentNode = FindNodeById(currentPlayingNodeId);
-            if (currentNode) {
-                // Check if the current node's audio has finished playing
-                if (!audioManager.IsPlaying(currentNode->audioIndex)) {
-                    int nextNodeId = -1;
-                    int selectedPin;
-
-                    // Determine which output pin to follow based on node type
-                    if (currentNode->name == "If Node") {
-                        selectedPin = currentNode->condition ? currentNode->outputPin : currentNode->extraOutputPin;
-                    }
-                    else {
-                        // Use global 'state' for branching if not a dedicated 'If Node'
-                        selectedPin = state ? currentNode->outputPin : currentNode->extraOutputPin;
-                    }
-
-                    // Traverse links to find the input pin connected to the selected output pin
-                    for (const auto& l : links) {
-                        if (l.startAttr == selectedPin) {
-                            for (const auto& next : audioNodes) {
-                                if (next.inputPin == l.endAttr) {
-                                    nextNodeId = next.id;
-                                    break;
-                                }
-                            }
-                        }
-                        if (nextNodeId != -1) break;
-                    }
-
-                    // Transition to the next node
-                    if (nextNodeId != -1) {
-                        AudioNode* nextNode = FindNodeById(nextNodeId);
-                        if (nextNode) {
-                            // Only play audio if the node has an associated audio index
-                            if (nextNode->audioIndex != -1) audioManager.Play(nextNode->audioIndex, false);
-                            currentPlayingNodeId = nextNodeId;
-                        }
-                        else currentPlayingNodeId = -1;
-                    }
-                    else currentPlayingNodeId = -1; // End of audio flow
+            if (!currentNode) currentPlayingNodeId = -1;
+            else if (!has_audio(currentNode->sound)) {
+                // Nodes without audio pass straight through, as do those whose file failed to load
+                int nextNodeId = NextAudioNodeId(*currentNode);
+                AudioNode* nextNode = FindNodeById(nextNodeId);
+                if (nextNode) audioManager.Play(nextNode->sound, false);
+                currentPlayingNodeId = nextNodeId; // -1 at the end of the audio flow
+            }
+            else {
+                // Keep the next node's audio queued behind the current one so the seam is gapless;
+                // a branch change before the end simply queues another node, one past the seam is too late
+                int followerId = NextAudioNodeId(*currentNode);
+                if (followerId != queuedNodeId && audioManager.IsPlaying(currentNode->sound)) {
+                    AudioNode* follower = FindNodeById(followerId);
+                    audioManager.QueueAfter(currentNode->sound,
+                        follower && has_audio(follower->sound) ? follower->sound : SoundHandle());
+                    if (audioManager.IsPlaying(currentNode->sound)) queuedNodeId = followerId;
+                }
+
+                // Transition to the next node, whose audio the end event found already started
+                if (currentNodeEnded) {
+                    currentNodeEnded = false;
+                    currentPlayingNodeId = queuedNodeId;
+                    queuedNodeId = -1;
+                    AudioNode* nextNode = FindNodeById(currentPlayingNodeId);
+                    // A node linked to itself cannot follow itself; it restarts instead
+                    if (nextNode && !audioManager.IsPlaying(nextNode->sound)) audioManager.Play(nextNode->sound, false);
                 }
             }
-            else currentPlayingNodeId = -1;
         }
 
         // --- ImGui/ImNodes Rendering Setup ---
@@ -235,7 +290,7 @@ int main() {
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
-        // Helper lambda to create and initialize a new audio node
+        // Helper lambda to create and initialize a new audio node without stalling the frame
         auto create_audio_node = [&](const std::string& name, const std::string& path) {
             AudioNode n;
             n.id = nextId++;
@@ -243,7 +298,7 @@ int main() {
             n.outputPin = nextId++;
             n.extraOutputPin = nextId++;
             n.name = name;
-            n.audioIndex = audioManager.LoadWav(path.c_str());
+            n.sound = audioManager.LoadWavAsync(path);
             audioNodes.push_back(n);
             };
 
@@ -270,7 +325,7 @@ int main() {
                     n.outputPin = nextId++;
                     n.extraOutputPin = nextId++;
                     n.name = "If Node";
-                    n.audioIndex = -1; // No associated audio
+                    n.sound = SoundHandle(); // No associated audio
                     n.condition = true;
                     audioNodes.push_back(n);
                 }
@@ -300,8 +355,16 @@ int main() {
             ImNodes::EndNodeTitleBar();
 
             // Node content display
-            if (n.audioIndex != -1) ImGui::Text("Audio Index: %d", n.audioIndex);
-            if (n.id == currentPlayingNodeId) ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "-> PLAYING");
+            if (!n.sound.IsNull()) ImGui::Text("Audio Index: %u", n.sound.index);
+            if (!n.sound.IsNull()) {
+                AudioManager::LoadStatus status = audioManager.GetLoadStatus(n.sound);
+                if (status == AudioManager::kLoading) ImGui::Text("(loading)");
+                else if (status == AudioManager::kLoadFailed) ImGui::Text("(failed to load)");
+            }
+            if (n.id == currentPlayingNodeId) {
+                ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "-> PLAYING");
+                ImGui::Text("Last seam error: %d samples", audioManager.LastSeamError());
+            }
 
             // Manual Play button logic
             std::string playId = "Play##" + std::to_string(n.id);
@@ -309,11 +372,13 @@ int main() {
                 // Stop any previously playing node
                 if (currentPlayingNodeId != -1) {
                     AudioNode* prevNode = FindNodeById(currentPlayingNodeId);
-                    if (prevNode && prevNode->audioIndex != -1) audioManager.Stop(prevNode->audioIndex);
+                    if (prevNode && !prevNode->sound.IsNull()) audioManager.Stop(prevNode->sound);
                 }
                 // Start playing this node
-                if (n.audioIndex != -1) audioManager.Play(n.audioIndex, false);
+                if (!n.sound.IsNull()) audioManager.Play(n.sound, false);
                 currentPlayingNodeId = n.id;
+                currentNodeEnded = false;
+                queuedNodeId = -1; // Stopping the previous node dropped its follower
             }
 
             // Delete button logic
@@ -321,10 +386,13 @@ int main() {
             std::string deleteId = "Delete##" + std::to_string(n.id);
             if (ImGui::Button(deleteId.c_str())) {
                 // Stop audio if this node is currently playing
-                if (n.id == currentPlayingNodeId && n.audioIndex != -1) {
-                    audioManager.Stop(n.audioIndex);
+                if (n.id == currentPlayingNodeId && !n.sound.IsNull()) {
+                    audioManager.Stop(n.sound);
                     currentPlayingNodeId = -1;
+                    queuedNodeId = -1;
                 }
+                // Release the node's source; the shared buffer goes with the last user
+                if (!n.sound.IsNull()) audioManager.Unload(n.sound);
                 n.to_delete = true; // Mark for deletion
             }
 
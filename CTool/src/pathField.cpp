@@ -0,0 +1,162 @@
+/**
+ * @file pathField.cpp
+ * @brief Bounded listener distance field, flooded with a bucket queue.
+ */
+
+#include <pathField.h>
+#include <algorithm>
+#include <cmath>
+
+/** @brief Sentinel cost of the cells no fill has reached. */
+static const uint32_t kUnreached = 0xFFFFFFFFu;
+
+/**
+ * @brief Creates a field without grid.
+ */
+PathField::PathField()
+    : generation_(0),
+    width_(0),
+    height_(0),
+    cellSize_(1.0f),
+    originX_(0),
+    originY_(0),
+    radius_(-1.0f) {
+}
+
+/**
+ * @brief Copies a collision grid and invalidates the field.
+ *
+ * @param cells One value per cell, row by row; nonzero cells block sound. Null removes the grid.
+ * @param width The number of columns.
+ * @param height The number of rows.
+ * @param cellSize The size of a cell in world units.
+ */
+void PathField::SetGrid(const int* cells, int width, int height, float cellSize) {
+    width_ = cells ? width : 0;
+    height_ = cells ? height : 0;
+    cellSize_ = cellSize > 0.0f ? cellSize : 1.0f;
+    size_t count = static_cast<size_t>(width_) * height_;
+    walls_.assign(count, 0);
+    for (size_t i = 0; i < count; i++) walls_[i] = cells[i] != 0;
+    cost_.assign(count, 0);
+    stamp_.assign(count, 0);
+    generation_ = 0;
+    radius_ = -1.0f;
+}
+
+/**
+ * @brief Refills the field if the listener changed cell or a wider radius is needed.
+ *
+ * @param listenerX The listener's X-coordinate in world units.
+ * @param listenerY The listener's Y-coordinate in world units.
+ * @param radius The walking distance, in world units, up to which the field must be valid.
+ * @return True if the field was refilled.
+ */
+bool PathField::Update(float listenerX, float listenerY, float radius) {
+    if (!HasGrid()) return false;
+    int x = static_cast<int>(std::floor(listenerX / cellSize_));
+    int y = static_cast<int>(std::floor(listenerY / cellSize_));
+    if (radius_ >= radius && x == originX_ && y == originY_) return false;
+
+    originX_ = x;
+    originY_ = y;
+    radius_ = radius;
+    Flood(x, y, static_cast<uint32_t>(std::ceil(radius / cellSize_ * kStraight)));
+    return true;
+}
+
+/**
+ * @brief Returns the walking distance from the listener to a point, in world units.
+ *
+ * A point inside a wall takes the distance of its nearest open neighbour, so
+ * an emitter placed on a wall tile is still heard from the side it faces.
+ *
+ * @return The distance, or -1 if the point was not reached within the radius.
+ */
+float PathField::DistanceAt(float x, float y) const {
+    int cellX = static_cast<int>(std::floor(x / cellSize_));
+    int cellY = static_cast<int>(std::floor(y / cellSize_));
+    if (cellX < 0 || cellY < 0 || cellX >= width_ || cellY >= height_) return -1.0f;
+
+    uint32_t cost = CostAt(cellX, cellY);
+    if (walls_[cellY * width_ + cellX] != 0) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                uint32_t step = dx != 0 && dy != 0 ? kDiagonal : kStraight;
+                uint32_t around = CostAt(cellX + dx, cellY + dy);
+                if (around != kUnreached) cost = std::min(cost, around + step);
+            }
+        }
+    }
+    if (cost == kUnreached) return -1.0f;
+    return static_cast<float>(cost) / kStraight * cellSize_;
+}
+
+/**
+ * @brief Fills the cost of every open cell within a limit of the origin.
+ *
+ * Dial's algorithm: all pending costs lie within kDiagonal of the one being
+ * expanded, so the bucket of cost c is c modulo kBuckets, and a cell whose
+ * cost went down after being queued is skipped when its old entry comes up.
+ *
+ * @param limit The largest cost to fill.
+ */
+void PathField::Flood(int originX, int originY, uint32_t limit) {
+    if (++generation_ == 0) {
+        // Wrapped around: old stamps could match again
+        std::fill(stamp_.begin(), stamp_.end(), 0);
+        generation_ = 1;
+    }
+    if (!IsOpen(originX, originY)) return;
+
+    static const int kSteps[8][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 }, { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+
+    int origin = originY * width_ + originX;
+    stamp_[origin] = generation_;
+    cost_[origin] = 0;
+    buckets_[0].push_back(origin);
+    size_t pending = 1;
+
+    for (uint32_t cost = 0; pending > 0; cost++) {
+        std::vector<int>& bucket = buckets_[cost % kBuckets];
+        // Expanding never adds to this bucket: every step costs at least 1 and at most kBuckets - 1
+        for (int cell : bucket) {
+            if (cost_[cell] != cost) continue;
+            int x = cell % width_, y = cell / width_;
+
+            for (int i = 0; i < 8; i++) {
+                int nx = x + kSteps[i][0], ny = y + kSteps[i][1];
+                if (!IsOpen(nx, ny)) continue;
+                bool diagonal = i >= 4;
+                if (diagonal && (!IsOpen(nx, y) || !IsOpen(x, ny))) continue; // No squeezing between corners
+                uint32_t next = cost + (diagonal ? kDiagonal : kStraight);
+                if (next > limit) continue;
+
+                int neighbour = ny * width_ + nx;
+                if (stamp_[neighbour] == generation_ && cost_[neighbour] <= next) continue;
+                stamp_[neighbour] = generation_;
+                cost_[neighbour] = next;
+                buckets_[next % kBuckets].push_back(neighbour);
+                pending++;
+            }
+        }
+        pending -= bucket.size();
+        bucket.clear();
+    }
+}
+
+/**
+ * @brief Returns true if a cell is inside the grid and lets sound through.
+ */
+bool PathField::IsOpen(int x, int y) const {
+    return x >= 0 && y >= 0 && x < width_ && y < height_ && walls_[y * width_ + x] == 0;
+}
+
+/**
+ * @brief Returns the cost of a cell in the current fill, or kUnreached.
+ */
+uint32_t PathField::CostAt(int x, int y) const {
+    if (x < 0 || y < 0 || x >= width_ || y >= height_) return kUnreached;
+    int cell = y * width_ + x;
+    return stamp_[cell] == generation_ && generation_ != 0 ? cost_[cell] : kUnreached;
+}
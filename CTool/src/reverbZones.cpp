@@ -0,0 +1,267 @@
+/**
+ * @file reverbZones.cpp
+ * @brief Map regions mapped to EFX reverb presets, blended through two effect slots.
+ */
+
+#include <reverbZones.h>
+#include <alCheck.h>
+#include <algorithm>
+
+/** @brief Seconds the reverb takes to blend into the next zone's. */
+static const float kBlendTime = 0.5f;
+
+/**
+ * @brief Creates an empty set of zones; call Init once a context is current.
+ */
+ReverbZones::ReverbZones()
+    : genEffects_(nullptr),
+    deleteEffects_(nullptr),
+    effecti_(nullptr),
+    effectf_(nullptr),
+    effectfv_(nullptr),
+    genSlots_(nullptr),
+    deleteSlots_(nullptr),
+    sloti_(nullptr),
+    slotf_(nullptr),
+    eaxReverb_(false),
+    effects_{ 0, 0 },
+    slots_{ 0, 0 },
+    slotZone_{ 0, 0 },
+    slotGain_{ 0.0f, 0.0f },
+    active_(0),
+    width_(0),
+    height_(0),
+    cellSize_(1.0f) {
+}
+
+/**
+ * @brief Loads the EFX functions and creates the two effects and slots.
+ *
+ * The context must be current and should have been created with kSends
+ * auxiliary sends per source.
+ *
+ * @param device The open device.
+ * @return True if EFX is available; otherwise zones are tracked but not heard.
+ */
+bool ReverbZones::Init(ALCdevice* device) {
+    if (!alcIsExtensionPresent(device, ALC_EXT_EFX_NAME)) return false;
+
+    genEffects_ = reinterpret_cast<LPALGENEFFECTS>(alGetProcAddress("alGenEffects"));
+    deleteEffects_ = reinterpret_cast<LPALDELETEEFFECTS>(alGetProcAddress("alDeleteEffects"));
+    effecti_ = reinterpret_cast<LPALEFFECTI>(alGetProcAddress("alEffecti"));
+    effectf_ = reinterpret_cast<LPALEFFECTF>(alGetProcAddress("alEffectf"));
+    effectfv_ = reinterpret_cast<LPALEFFECTFV>(alGetProcAddress("alEffectfv"));
+    genSlots_ = reinterpret_cast<LPALGENAUXILIARYEFFECTSLOTS>(alGetProcAddress("alGenAuxiliaryEffectSlots"));
+    deleteSlots_ = reinterpret_cast<LPALDELETEAUXILIARYEFFECTSLOTS>(alGetProcAddress("alDeleteAuxiliaryEffectSlots"));
+    sloti_ = reinterpret_cast<LPALAUXILIARYEFFECTSLOTI>(alGetProcAddress("alAuxiliaryEffectSloti"));
+    slotf_ = reinterpret_cast<LPALAUXILIARYEFFECTSLOTF>(alGetProcAddress("alAuxiliaryEffectSlotf"));
+    if (!genEffects_ || !deleteEffects_ || !effecti_ || !effectf_ || !effectfv_ || !genSlots_ ||
+        !deleteSlots_ || !sloti_ || !slotf_) {
+        return false;
+    }
+
+    alGetError();
+    AL_PROBE(genEffects_(kSends, effects_));
+    AL_PROBE(genSlots_(kSends, slots_));
+    if (alGetError() != AL_NO_ERROR) {
+        slots_[0] = 0;
+        return false;
+    }
+
+    // EAX reverb has every parameter of the presets; the standard one is the fallback
+    AL_PROBE(effecti_(effects_[0], AL_EFFECT_TYPE, AL_EFFECT_EAXREVERB));
+    eaxReverb_ = alGetError() == AL_NO_ERROR;
+    for (int i = 0; i < kSends; i++) {
+        AL_CALL(effecti_(effects_[i], AL_EFFECT_TYPE, eaxReverb_ ? AL_EFFECT_EAXREVERB : AL_EFFECT_REVERB));
+        AL_CALL(slotf_(slots_[i], AL_EFFECTSLOT_GAIN, 0.0f));
+        slotZone_[i] = 0;
+        slotGain_[i] = 0.0f;
+    }
+    active_ = 0;
+    return true;
+}
+
+/**
+ * @brief Deletes the slots and effects; sources must be detached or deleted first.
+ */
+void ReverbZones::Close() {
+    if (IsAvailable()) {
+        AL_CALL(deleteSlots_(kSends, slots_));
+        AL_CALL(deleteEffects_(kSends, effects_));
+    }
+    for (int i = 0; i < kSends; i++) {
+        effects_[i] = 0;
+        slots_[i] = 0;
+        slotZone_[i] = 0;
+        slotGain_[i] = 0.0f;
+    }
+    presets_.clear();
+    grid_.assign(grid_.size(), 0);
+}
+
+/**
+ * @brief Connects a source's auxiliary sends to both slots, for good.
+ */
+void ReverbZones::Attach(ALuint source) const {
+    if (!IsAvailable()) return;
+    for (int i = 0; i < kSends; i++) {
+        AL_CALL(alSource3i(source, AL_AUXILIARY_SEND_FILTER, static_cast<ALint>(slots_[i]), i, AL_FILTER_NULL));
+    }
+}
+
+/**
+ * @brief Sets the size of the zone grid, clearing every cell to no reverb.
+ *
+ * @param width The number of columns.
+ * @param height The number of rows.
+ * @param cellSize The size of a cell in world units (the units of the listener position).
+ */
+void ReverbZones::SetGrid(int width, int height, float cellSize) {
+    width_ = std::max(width, 0);
+    height_ = std::max(height, 0);
+    cellSize_ = cellSize > 0.0f ? cellSize : 1.0f;
+    grid_.assign(static_cast<size_t>(width_) * height_, 0);
+}
+
+/**
+ * @brief Registers a reverb preset, e.g. one of efx-presets.h.
+ *
+ * @return The id of the new zone, from 1 up; -1 once 255 zones exist.
+ */
+int ReverbZones::AddZone(const EFXEAXREVERBPROPERTIES& preset) {
+    if (presets_.size() >= 255) return -1;
+    presets_.push_back(preset);
+    return static_cast<int>(presets_.size());
+}
+
+/**
+ * @brief Assigns a rectangle of cells to a zone; 0 clears them.
+ *
+ * The rectangle is clipped to the grid.
+ */
+void ReverbZones::FillRect(int zone, int x, int y, int width, int height) {
+    if (zone < 0 || zone > static_cast<int>(presets_.size())) return;
+    int x0 = std::max(x, 0), x1 = std::min(x + width, width_);
+    int y0 = std::max(y, 0), y1 = std::min(y + height, height_);
+    for (int row = y0; row < y1; row++) {
+        for (int col = x0; col < x1; col++) grid_[row * width_ + col] = static_cast<uint8_t>(zone);
+    }
+}
+
+/**
+ * @brief Assigns the cells set in a mask to a zone; 0 clears them.
+ *
+ * @param zone The zone id.
+ * @param mask One byte per cell in grid order, nonzero for the cells of the zone.
+ */
+void ReverbZones::FillMask(int zone, const unsigned char* mask) {
+    if (zone < 0 || zone > static_cast<int>(presets_.size()) || !mask) return;
+    for (size_t i = 0; i < grid_.size(); i++) {
+        if (mask[i]) grid_[i] = static_cast<uint8_t>(zone);
+    }
+}
+
+/**
+ * @brief Returns the zone of the cell holding a world position, 0 outside the grid.
+ */
+int ReverbZones::ZoneAt(float x, float y) const {
+    float col = x / cellSize_, row = y / cellSize_;
+    if (col < 0.0f || row < 0.0f || col >= width_ || row >= height_) return 0;
+    return grid_[static_cast<int>(row) * width_ + static_cast<int>(col)];
+}
+
+/**
+ * @brief Follows the listener into its zone and moves the slot blend along.
+ *
+ * When the zone changes, the slot already holding its preset (walking back
+ * out of a doorway) or else the idle slot becomes active, and the other slot
+ * fades out over kBlendTime while it fades in. Slot gains are only submitted
+ * when they move.
+ *
+ * A preset is only loaded into a silent slot: rewriting one that is still
+ * fading out would make its tail jump to the new reverb. So when the
+ * listener crosses a second edge within kBlendTime, both slots fade out, and
+ * the new zone's reverb starts once the idle slot has gone quiet.
+ *
+ * @param listenerX The listener position in world units.
+ * @param listenerY The listener position in world units.
+ * @param deltaTime The time elapsed since the last update, in seconds.
+ */
+void ReverbZones::Update(float listenerX, float listenerY, float deltaTime) {
+    if (!IsAvailable()) return;
+
+    int zone = ZoneAt(listenerX, listenerY);
+    if (zone != 0 && zone != slotZone_[active_]) {
+        int idle = 1 - active_;
+        if (slotZone_[idle] == zone) {
+            active_ = idle;
+        }
+        else if (slotGain_[idle] == 0.0f) {
+            LoadPreset(effects_[idle], presets_[zone - 1]);
+            AL_CALL(sloti_(slots_[idle], AL_EFFECTSLOT_EFFECT, static_cast<ALint>(effects_[idle])));
+            slotZone_[idle] = zone;
+            active_ = idle;
+        }
+        // Otherwise the idle slot is still fading out an older zone; it is loaded once silent
+    }
+
+    // Only the slot holding the listener's zone is heard, so leaving every zone fades both out
+    float step = deltaTime / kBlendTime;
+    for (int i = 0; i < kSends; i++) {
+        float target = i == active_ && slotZone_[i] == zone && zone != 0 ? 1.0f : 0.0f;
+        float gain = slotGain_[i] < target ? std::min(slotGain_[i] + step, target)
+            : std::max(slotGain_[i] - step, target);
+        if (gain == slotGain_[i]) continue;
+        slotGain_[i] = gain;
+        AL_CALL(slotf_(slots_[i], AL_EFFECTSLOT_GAIN, gain));
+    }
+}
+
+/**
+ * @brief Writes a preset into an effect, with the parameters its type supports.
+ *
+ * An effect's parameters are copied into a slot when it is attached, so the
+ * caller re-attaches the effect afterwards.
+ */
+void ReverbZones::LoadPreset(ALuint effect, const EFXEAXREVERBPROPERTIES& preset) const {
+    if (eaxReverb_) {
+        AL_CALL(effectf_(effect, AL_EAXREVERB_DENSITY, preset.flDensity));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_DIFFUSION, preset.flDiffusion));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_GAIN, preset.flGain));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_GAINHF, preset.flGainHF));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_GAINLF, preset.flGainLF));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_DECAY_TIME, preset.flDecayTime));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_DECAY_HFRATIO, preset.flDecayHFRatio));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_DECAY_LFRATIO, preset.flDecayLFRatio));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_REFLECTIONS_GAIN, preset.flReflectionsGain));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_REFLECTIONS_DELAY, preset.flReflectionsDelay));
+        AL_CALL(effectfv_(effect, AL_EAXREVERB_REFLECTIONS_PAN, preset.flReflectionsPan));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_LATE_REVERB_GAIN, preset.flLateReverbGain));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_LATE_REVERB_DELAY, preset.flLateReverbDelay));
+        AL_CALL(effectfv_(effect, AL_EAXREVERB_LATE_REVERB_PAN, preset.flLateReverbPan));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_ECHO_TIME, preset.flEchoTime));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_ECHO_DEPTH, preset.flEchoDepth));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_MODULATION_TIME, preset.flModulationTime));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_MODULATION_DEPTH, preset.flModulationDepth));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_AIR_ABSORPTION_GAINHF, preset.flAirAbsorptionGainHF));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_HFREFERENCE, preset.flHFReference));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_LFREFERENCE, preset.flLFReference));
+        AL_CALL(effectf_(effect, AL_EAXREVERB_ROOM_ROLLOFF_FACTOR, preset.flRoomRolloffFactor));
+        AL_CALL(effecti_(effect, AL_EAXREVERB_DECAY_HFLIMIT, preset.iDecayHFLimit));
+        return;
+    }
+
+    AL_CALL(effectf_(effect, AL_REVERB_DENSITY, preset.flDensity));
+    AL_CALL(effectf_(effect, AL_REVERB_DIFFUSION, preset.flDiffusion));
+    AL_CALL(effectf_(effect, AL_REVERB_GAIN, preset.flGain));
+    AL_CALL(effectf_(effect, AL_REVERB_GAINHF, preset.flGainHF));
+    AL_CALL(effectf_(effect, AL_REVERB_DECAY_TIME, preset.flDecayTime));
+    AL_CALL(effectf_(effect, AL_REVERB_DECAY_HFRATIO, preset.flDecayHFRatio));
+    AL_CALL(effectf_(effect, AL_REVERB_REFLECTIONS_GAIN, preset.flReflectionsGain));
+    AL_CALL(effectf_(effect, AL_REVERB_REFLECTIONS_DELAY, preset.flReflectionsDelay));
+    AL_CALL(effectf_(effect, AL_REVERB_LATE_REVERB_GAIN, preset.flLateReverbGain));
+    AL_CALL(effectf_(effect, AL_REVERB_LATE_REVERB_DELAY, preset.flLateReverbDelay));
+    AL_CALL(effectf_(effect, AL_REVERB_AIR_ABSORPTION_GAINHF, preset.flAirAbsorptionGainHF));
+    AL_CALL(effectf_(effect, AL_REVERB_ROOM_ROLLOFF_FACTOR, preset.flRoomRolloffFactor));
+    AL_CALL(effecti_(effect, AL_REVERB_DECAY_HFLIMIT, preset.iDecayHFLimit));
+}
@@ -0,0 +1,311 @@
+/**
+ * @file sampleConvert.cpp
+ * @brief Scalar, SSE and AVX2 conversion of WAV samples to 16-bit or float, chosen at runtime.
+ *
+ * Like the SpatialKernel levels, the vector versions are compiled for their
+ * instruction set function by function. Each one converts as many samples as
+ * fill its registers and leaves the rest to the scalar loop, which defines
+ * the results: truncation to the top 16 bits for integers, clamping and
+ * rounding to nearest for floats, and exact scaling for the widening to float.
+ */
+
+#include <sampleConvert.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CONVERT_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define CONVERT_TARGET_AVX2
+#else
+#define CONVERT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+/** @brief Scales of the widening to float: one over the full scale of 24 and 32-bit integers. */
+static const float kScale24 = 1.0f / 8388608.0f;
+static const float kScale32 = 1.0f / 2147483648.0f;
+
+/**
+ * @brief Returns true for the AL_EXT_FLOAT32 formats.
+ */
+static bool IsFloatFormat(ALenum format) {
+    return format == AL_FORMAT_MONO_FLOAT32 || format == AL_FORMAT_STEREO_FLOAT32;
+}
+
+/**
+ * @brief Picks the format a WAV file is uploaded in.
+ *
+ * @param info The parsed file.
+ * @param floatFormats True if the device has AL_EXT_FLOAT32.
+ * @return info.format when the samples can go up as they are; otherwise the
+ *         format Convert has to turn them into.
+ */
+ALenum SampleConvert::TargetFormat(const WavInfo& info, bool floatFormats) {
+    bool stereo = info.numChannels == 2;
+    if (info.encoding == kWavPcm8 || info.encoding == kWavPcm16) return info.format;
+    if (floatFormats) return stereo ? AL_FORMAT_STEREO_FLOAT32 : AL_FORMAT_MONO_FLOAT32;
+    return stereo ? AL_FORMAT_STEREO16 : AL_FORMAT_MONO16;
+}
+
+/**
+ * @brief Returns the size in bytes of one sample of an encoding, or 0 if it is unsupported.
+ */
+int SampleConvert::SampleBytes(WavEncoding encoding) {
+    switch (encoding) {
+    case kWavPcm8:    return 1;
+    case kWavPcm16:   return 2;
+    case kWavPcm24:   return 3;
+    case kWavPcm32:   return 4;
+    case kWavFloat32: return 4;
+    default:          return 0;
+    }
+}
+
+/**
+ * @brief Returns the size of samples once converted by Convert.
+ *
+ * @param encoding The encoding of the samples.
+ * @param bytes Their size; a trailing partial sample is dropped.
+ * @param format The target format (16-bit or float).
+ */
+size_t SampleConvert::TargetSize(WavEncoding encoding, size_t bytes, ALenum format) {
+    int sampleBytes = SampleBytes(encoding);
+    if (sampleBytes == 0) return 0;
+    return bytes / sampleBytes * (IsFloatFormat(format) ? sizeof(float) : sizeof(int16_t));
+}
+
+/**
+ * @brief Sign-extends a little-endian 24-bit sample.
+ */
+static int32_t Read24(const unsigned char* p) {
+    uint32_t bits = static_cast<uint32_t>(p[0]) << 8 | static_cast<uint32_t>(p[1]) << 16 | static_cast<uint32_t>(p[2]) << 24;
+    return static_cast<int32_t>(bits) >> 8;
+}
+
+/**
+ * @brief Reads a 32-bit sample at an unaligned address.
+ */
+template <typename T>
+static T Read32(const unsigned char* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Clamps a float sample to [-1, 1] and rounds it to 16 bits.
+ */
+static int16_t FloatTo16(float x) {
+    // Same order and operands as min/max in the vector versions, so NaN ends up at +1 on every level
+    x = x < 1.0f ? x : 1.0f;
+    x = x > -1.0f ? x : -1.0f;
+    return static_cast<int16_t>(std::lrint(x * 32767.0f));
+}
+
+/**
+ * @brief Converts samples [begin, end) to 16-bit, one at a time.
+ */
+static void ToPcm16Scalar(WavEncoding encoding, const unsigned char* in, int16_t* out, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        switch (encoding) {
+        case kWavPcm24:   out[i] = static_cast<int16_t>(Read24(in + 3 * i) >> 8); break;
+        case kWavPcm32:   out[i] = static_cast<int16_t>(Read32<int32_t>(in + 4 * i) >> 16); break;
+        case kWavFloat32: out[i] = FloatTo16(Read32<float>(in + 4 * i)); break;
+        default:          out[i] = 0; break;
+        }
+    }
+}
+
+/**
+ * @brief Converts samples [begin, end) to float, one at a time.
+ */
+static void ToFloatScalar(WavEncoding encoding, const unsigned char* in, float* out, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        switch (encoding) {
+        case kWavPcm24:   out[i] = static_cast<float>(Read24(in + 3 * i)) * kScale24; break;
+        case kWavPcm32:   out[i] = static_cast<float>(Read32<int32_t>(in + 4 * i)) * kScale32; break;
+        case kWavFloat32: out[i] = Read32<float>(in + 4 * i); break;
+        default:          out[i] = 0.0f; break;
+        }
+    }
+}
+
+#ifdef CONVERT_X86
+/**
+ * @brief Converts 32-bit integers and floats to 16-bit 8 at a time.
+ *
+ * SSE2 has no byte shuffle, so 24-bit samples are left to the scalar loop.
+ *
+ * @return The number of samples converted.
+ */
+static size_t ToPcm16Sse(WavEncoding encoding, const unsigned char* in, int16_t* out, size_t count) {
+    const __m128 one = _mm_set1_ps(1.0f), minusOne = _mm_set1_ps(-1.0f), fullScale = _mm_set1_ps(32767.0f);
+    size_t i = 0;
+
+    if (encoding == kWavPcm32) {
+        for (; i + 8 <= count; i += 8) {
+            __m128i a = _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4 * i)), 16);
+            __m128i b = _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4 * i + 16)), 16);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(a, b));
+        }
+    }
+    else if (encoding == kWavFloat32) {
+        for (; i + 8 <= count; i += 8) {
+            __m128 a = _mm_loadu_ps(reinterpret_cast<const float*>(in + 4 * i));
+            __m128 b = _mm_loadu_ps(reinterpret_cast<const float*>(in + 4 * i + 16));
+            a = _mm_mul_ps(_mm_max_ps(_mm_min_ps(a, one), minusOne), fullScale);
+            b = _mm_mul_ps(_mm_max_ps(_mm_min_ps(b, one), minusOne), fullScale);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+        }
+    }
+    return i;
+}
+
+/**
+ * @brief Widens 32-bit integers to float 4 at a time (24-bit ones are left to the scalar loop).
+ *
+ * @return The number of samples converted.
+ */
+static size_t ToFloatSse(WavEncoding encoding, const unsigned char* in, float* out, size_t count) {
+    const __m128 scale = _mm_set1_ps(kScale32);
+    size_t i = 0;
+
+    if (encoding == kWavPcm32) {
+        for (; i + 4 <= count; i += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4 * i));
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+        }
+    }
+    return i;
+}
+
+/**
+ * @brief Loads 8 packed 24-bit samples, 4 per 128-bit lane, each lane starting on a sample.
+ *
+ * Reads 28 bytes, 4 past the samples, so the caller stops 10 samples short of the end.
+ */
+CONVERT_TARGET_AVX2
+static __m256i Load24(const unsigned char* p) {
+    __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12));
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+}
+
+/**
+ * @brief Converts 24-bit samples 8 at a time, and 32-bit integers and floats 16 at a time, to 16-bit.
+ *
+ * @return The number of samples converted.
+ */
+CONVERT_TARGET_AVX2
+static size_t ToPcm16Avx2(WavEncoding encoding, const unsigned char* in, int16_t* out, size_t count) {
+    const __m256 one = _mm256_set1_ps(1.0f), minusOne = _mm256_set1_ps(-1.0f), fullScale = _mm256_set1_ps(32767.0f);
+    size_t i = 0;
+
+    if (encoding == kWavPcm24) {
+        // The top two bytes of each sample to the low half of its lane, then both low halves together
+        const __m256i top = _mm256_setr_epi8(1, 2, 4, 5, 7, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1,
+            1, 2, 4, 5, 7, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1);
+        for (; i + 10 <= count; i += 8) {
+            __m256i v = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(Load24(in + 3 * i), top), 0x08);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_castsi256_si128(v));
+        }
+    }
+    else if (encoding == kWavPcm32) {
+        for (; i + 16 <= count; i += 16) {
+            __m256i a = _mm256_srai_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 4 * i)), 16);
+            __m256i b = _mm256_srai_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 4 * i + 32)), 16);
+            // The pack works per lane; put the four quarters back in order
+            __m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+        }
+    }
+    else if (encoding == kWavFloat32) {
+        for (; i + 16 <= count; i += 16) {
+            __m256 a = _mm256_loadu_ps(reinterpret_cast<const float*>(in + 4 * i));
+            __m256 b = _mm256_loadu_ps(reinterpret_cast<const float*>(in + 4 * i + 32));
+            a = _mm256_mul_ps(_mm256_max_ps(_mm256_min_ps(a, one), minusOne), fullScale);
+            b = _mm256_mul_ps(_mm256_max_ps(_mm256_min_ps(b, one), minusOne), fullScale);
+            __m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b)), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+        }
+    }
+    return i;
+}
+
+/**
+ * @brief Widens 24 and 32-bit integers to float 8 at a time.
+ *
+ * @return The number of samples converted.
+ */
+CONVERT_TARGET_AVX2
+static size_t ToFloatAvx2(WavEncoding encoding, const unsigned char* in, float* out, size_t count) {
+    size_t i = 0;
+
+    if (encoding == kWavPcm24) {
+        // Each sample to the top 3 bytes of a 32-bit integer, then shifted back down with its sign
+        const __m256i widen = _mm256_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+            -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+        const __m256 scale = _mm256_set1_ps(kScale24);
+        for (; i + 10 <= count; i += 8) {
+            __m256i v = _mm256_srai_epi32(_mm256_shuffle_epi8(Load24(in + 3 * i), widen), 8);
+            _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+        }
+    }
+    else if (encoding == kWavPcm32) {
+        const __m256 scale = _mm256_set1_ps(kScale32);
+        for (; i + 8 <= count; i += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 4 * i));
+            _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+        }
+    }
+    return i;
+}
+#endif
+
+/**
+ * @brief Converts samples at the best level available.
+ *
+ * @param encoding The encoding of the samples (24 or 32-bit integers, or floats).
+ * @param samples The samples; no alignment is needed.
+ * @param bytes Their size; a trailing partial sample is dropped.
+ * @param format The target format, a 16-bit or float one (see TargetFormat).
+ * @param out Receives TargetSize(encoding, bytes, format) bytes.
+ */
+void SampleConvert::Convert(WavEncoding encoding, const unsigned char* samples, size_t bytes, ALenum format, void* out) {
+    static const SpatialKernel::Level level = SpatialKernel::Detect();
+    Convert(encoding, samples, bytes, format, out, level);
+}
+
+/**
+ * @brief Converts samples at a given level.
+ *
+ * A level the build cannot run (a vector level off x86) falls back to kScalar;
+ * the caller must not ask for one the CPU lacks (see SpatialKernel::Detect).
+ */
+void SampleConvert::Convert(WavEncoding encoding, const unsigned char* samples, size_t bytes, ALenum format, void* out,
+    SpatialKernel::Level level) {
+    int sampleBytes = SampleBytes(encoding);
+    if (sampleBytes == 0) return;
+    size_t count = bytes / sampleBytes;
+    size_t done = 0;
+
+    if (IsFloatFormat(format)) {
+        float* floats = static_cast<float*>(out);
+#ifdef CONVERT_X86
+        if (level == SpatialKernel::kAvx2) done = ToFloatAvx2(encoding, samples, floats, count);
+        else if (level == SpatialKernel::kSse) done = ToFloatSse(encoding, samples, floats, count);
+#endif
+        ToFloatScalar(encoding, samples, floats, done, count);
+    }
+    else {
+        int16_t* shorts = static_cast<int16_t*>(out);
+#ifdef CONVERT_X86
+        if (level == SpatialKernel::kAvx2) done = ToPcm16Avx2(encoding, samples, shorts, count);
+        else if (level == SpatialKernel::kSse) done = ToPcm16Sse(encoding, samples, shorts, count);
+#endif
+        ToPcm16Scalar(encoding, samples, shorts, done, count);
+    }
+}